@@ -0,0 +1,24 @@
+/*
+Bilateral blur weights shared by ssao_blur.fs and the fused blur of the compute AO pass (Tomasi and Manduchi, 1998)
+https://users.soe.ucsc.edu/~manduchi/Papers/ICCV98.pdf
+Taps are gaussian weighted and additionally weighted by how closely their linear depth
+(and optionally normal) matches the centre pixel's, so AO doesn't bleed across depth edges
+*/
+
+uniform int blurRadius = 4;               // taps on each side of the centre
+uniform float depthSharpness = 16.0;      // higher rejects taps across smaller relative depth steps
+uniform bool useNormals = false;
+uniform float normalPower = 8.0;          // higher rejects taps across smaller normal changes
+
+// weight of the tap offset taps from the centre along the blur axis, depths are linear
+float blurWeight(int offset, float centerDepth, float tapDepth, vec3 centerNormal, vec3 tapNormal)
+{
+    float sigma = (float(blurRadius) + 1.0) * 0.5;
+    float weight = exp(-float(offset * offset) / (2.0 * sigma * sigma));
+
+    float relativeDepth = abs(tapDepth - centerDepth) / max(centerDepth, 0.0001) * depthSharpness;
+    weight *= exp(-relativeDepth * relativeDepth);
+    if (useNormals)
+        weight *= pow(max(dot(tapNormal, centerNormal), 0.0), normalPower);
+    return weight;
+}
@@ -0,0 +1,87 @@
+/*
+Compute AO pass, included last by ssao.comp, hbao.comp and ssao_alch.comp
+Each workgroup loads the shared G-buffer tile of its block once (loadTile in gbuffer.glsl) and evaluates
+the technique's computeAO for every pixel of the block from there.
+With fuseBlur the workgroup also evaluates the AO of a BLUR_APRON ring around its block and runs both
+passes of the separable bilateral blur in shared memory, writing the blurred AO in the same dispatch
+*/
+
+#include "ao_blur.glsl"
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+layout(r16f, binding = 0) uniform writeonly image2D aoOutput;
+uniform bool fuseBlur = false;
+
+shared float tileAO[BLUR_REGION * BLUR_REGION];      // unblurred AO of the block and its blur apron
+shared float tileBlurred[BLUR_REGION * TILE_SIZE];   // horizontally blurred, every row of the region for the block's columns
+
+// AO pixel held by a texel of the blur region, pixels past the screen edge repeat the edge
+// the same way the fragment blur clamps its taps
+ivec2 getBlurRegionPixel(ivec2 local)
+{
+    return clamp(tileOrigin + TILE_APRON - BLUR_APRON + local, ivec2(0), aoSize - 1);
+}
+
+void main()
+{
+    aoSize = imageSize(aoOutput);
+    loadTile();
+
+    if (!fuseBlur)
+    {
+        aoPixel = ivec2(gl_GlobalInvocationID.xy);
+        if (all(lessThan(aoPixel, aoSize)))
+            imageStore(aoOutput, aoPixel, vec4(computeAO(getAOPixelUV(aoPixel))));
+        return;
+    }
+
+    // AO of the block and its blur apron, the apron is evaluated by every workgroup it borders
+    for (int i = int(gl_LocalInvocationIndex); i < BLUR_REGION * BLUR_REGION; i += TILE_SIZE * TILE_SIZE)
+    {
+        aoPixel = getBlurRegionPixel(ivec2(i % BLUR_REGION, i / BLUR_REGION));
+        tileAO[i] = computeAO(getAOPixelUV(aoPixel));
+    }
+    barrier();
+
+    // horizontal pass over every row of the region, only the block's columns are needed afterwards
+    int radius = min(blurRadius, BLUR_APRON);
+    for (int i = int(gl_LocalInvocationIndex); i < BLUR_REGION * TILE_SIZE; i += TILE_SIZE * TILE_SIZE)
+    {
+        ivec2 local = ivec2(BLUR_APRON + i % TILE_SIZE, i / TILE_SIZE);
+        ivec2 center = getBlurRegionPixel(local);
+        float centerDepth = getTileDepth(center);
+        vec3 centerNormal = getTileNormal(center);
+
+        float result = 0.0;
+        float totalWeight = 0.0;
+        for (int j = -radius; j <= radius; ++j)
+        {
+            ivec2 tap = getBlurRegionPixel(local + ivec2(j, 0));
+            float weight = blurWeight(j, centerDepth, getTileDepth(tap), centerNormal, getTileNormal(tap));
+            result += tileAO[local.y * BLUR_REGION + local.x + j] * weight;
+            totalWeight += weight;
+        }
+        tileBlurred[i] = result / max(totalWeight, 0.0001);
+    }
+    barrier();
+
+    // vertical pass for the block's own pixels
+    aoPixel = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 local = ivec2(gl_LocalInvocationID.xy) + ivec2(BLUR_APRON);
+    ivec2 center = getBlurRegionPixel(local);
+    float centerDepth = getTileDepth(center);
+    vec3 centerNormal = getTileNormal(center);
+
+    float result = 0.0;
+    float totalWeight = 0.0;
+    for (int j = -radius; j <= radius; ++j)
+    {
+        ivec2 tap = getBlurRegionPixel(local + ivec2(0, j));
+        float weight = blurWeight(j, centerDepth, getTileDepth(tap), centerNormal, getTileNormal(tap));
+        result += tileBlurred[(local.y + j) * TILE_SIZE + int(gl_LocalInvocationID.x)] * weight;
+        totalWeight += weight;
+    }
+    if (all(lessThan(aoPixel, aoSize)))
+        imageStore(aoOutput, aoPixel, vec4(result / max(totalWeight, 0.0001)));
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+/*
+Splits linear depth and view-space normals into quarter resolution layers, each layer holds
+the G-buffer pixels at one offset inside every 4x4 block (Bavoil, 2014)
+https://developer.nvidia.com/sites/default/files/akamai/gameworks/samples/DeinterleavedTexturing.pdf
+*/
+
+layout (location = 0) out float LinearDepth;
+layout (location = 1) out vec4 Normal;
+
+#include "gbuffer.glsl"
+
+uniform int deinterleaveLayer;
+
+void main()
+{
+    vec2 gBufferSize = getGBufferSize();
+    ivec2 offset = ivec2(deinterleaveLayer % 4, deinterleaveLayer / 4);
+    ivec2 pixel = min(ivec2(gl_FragCoord.xy) * 4 + offset, ivec2(gBufferSize) - 1);
+    vec2 uv = (vec2(pixel) + 0.5) / gBufferSize;
+
+    LinearDepth = -getViewPosition(uv).z;
+    Normal = vec4(getViewNormal(uv), 0.0);
+}
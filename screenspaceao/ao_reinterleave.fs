@@ -0,0 +1,16 @@
+#version 330 core
+
+/*
+Gathers the 16 quarter resolution AO layers back into a full resolution AO texture
+*/
+
+out float FragColor;
+
+uniform sampler2DArray aoLayers;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 offset = pixel % 4;
+    FragColor = texelFetch(aoLayers, ivec3(pixel / 4, offset.y * 4 + offset.x), 0).r;
+}
@@ -0,0 +1,50 @@
+#version 330 core
+
+/*
+Temporal accumulation of AO with camera reprojection
+Each pixel is reprojected into the previous frame with the previous view and projection,
+history whose stored linear depth doesn't match the reprojected depth is a disocclusion and is dropped,
+otherwise the new AO is blended in with a running average that bottoms out at minBlend
+(Mattausch et al., 2011, High-Quality Screen-Space Ambient Occlusion using Temporal Coherence)
+https://doi.org/10.1111/j.1467-8659.2011.01933.x
+*/
+
+out vec4 FragColor; // r = accumulated AO, g = history length in frames, b = linear depth
+
+in vec2 TexCoords;
+
+#include "gbuffer.glsl"
+
+uniform sampler2D aoInput;
+uniform sampler2D aoHistory;
+uniform mat4 prevViewProjection;
+uniform bool historyValid;
+uniform float minBlend = 0.1;        // weight of the new frame once the history is long enough
+uniform float depthTolerance = 0.02; // relative linear depth difference still accepted as the same surface
+uniform float maxHistory = 32.0;
+
+void main()
+{
+    float ao = texture(aoInput, TexCoords).r;
+    vec3 viewPos = getViewPosition(TexCoords);
+    float linearDepth = -viewPos.z;
+
+    // where this surface was on screen last frame, w is its linear depth back then
+    vec4 worldPos = invView * vec4(viewPos, 1.0);
+    vec4 prevClip = prevViewProjection * worldPos;
+    vec2 prevUV = prevClip.xy / prevClip.w * 0.5 + 0.5;
+
+    float historyLength = 0.0;
+    float result = ao;
+    bool onScreen = all(greaterThanEqual(prevUV, vec2(0.0))) && all(lessThanEqual(prevUV, vec2(1.0)));
+    if (historyValid && linearDepth > 0.0 && prevClip.w > 0.0 && onScreen)
+    {
+        vec4 history = texture(aoHistory, prevUV);
+        if (abs(history.b - prevClip.w) < depthTolerance * prevClip.w)
+        {
+            historyLength = history.g;
+            result = mix(history.r, ao, max(1.0 / (historyLength + 1.0), minBlend));
+        }
+    }
+    FragColor = vec4(result, min(historyLength + 1.0, maxHistory), linearDepth, 1.0);
+}
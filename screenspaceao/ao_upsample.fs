@@ -0,0 +1,53 @@
+#version 330 core
+
+/*
+Joint bilateral upsample of reduced resolution AO (Kopf et al., 2007)
+https://johanneskopf.de/publications/jbu/
+Each full resolution pixel blends the four nearest low resolution AO texels, weighted by
+bilinear distance and by how closely their depth and normal match the pixel's own
+*/
+
+out float FragColor;
+
+in vec2 TexCoords;
+
+#include "gbuffer.glsl"
+
+uniform sampler2D aoInput;
+uniform float depthSharpness = 32.0; // higher rejects texels across smaller relative depth steps
+uniform float normalPower = 8.0;     // higher rejects texels across smaller normal changes
+
+void main()
+{
+    vec2 lowSize = vec2(textureSize(aoInput, 0));
+    vec3 centerPos = getViewPosition(TexCoords);
+    vec3 centerNormal = getViewNormal(TexCoords);
+
+    // the 2x2 low resolution texels surrounding this pixel
+    vec2 lowCoord = TexCoords * lowSize - 0.5;
+    vec2 base = floor(lowCoord);
+    vec2 f = lowCoord - base;
+
+    float result = 0.0;
+    float weightSum = 0.0;
+    for (int i = 0; i < 4; ++i)
+    {
+        vec2 offset = vec2(i & 1, i >> 1);
+        vec2 uv = clamp((base + offset + 0.5) / lowSize, 0.5 / lowSize, 1.0 - 0.5 / lowSize);
+        vec2 bilinear2 = mix(1.0 - f, f, offset);
+        float bilinear = bilinear2.x * bilinear2.y;
+
+        // the AO texel was computed from the G-buffer sample at its own centre
+        vec3 samplePos = getViewPosition(uv);
+        vec3 sampleNormal = getViewNormal(uv);
+        float relativeDepth = abs(centerPos.z - samplePos.z) / max(abs(centerPos.z), 0.001);
+        float depthWeight = 1.0 / (0.001 + relativeDepth * depthSharpness);
+        float normalWeight = pow(max(dot(centerNormal, sampleNormal), 0.0), normalPower) + 0.0001;
+
+        float weight = bilinear * depthWeight * normalWeight;
+        result += texture(aoInput, uv).r * weight;
+        weightSum += weight;
+    }
+
+    FragColor = result / max(weightSum, 0.0001);
+}
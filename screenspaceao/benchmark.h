@@ -0,0 +1,277 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+/*
+Benchmark runner for the AO techniques
+Walks every camera preset x every AO setting for a fixed number of frames and
+writes a machine-readable report (JSON or CSV, picked from the output file extension)
+*/
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/gpu_profiler.h>
+
+struct BenchmarkResult {
+    int preset;
+    int aoSetting;
+    std::string aoName;
+    std::string variant; // shader permutation the AO pass ran, e.g. "KERNEL_SIZE=16"
+    int frames;
+    float avgFrameMs;
+    float minFrameMs;
+    float maxFrameMs;
+    float p99FrameMs;
+    float avgFPS;
+    std::vector<GpuPassStats> passes; // per-pass GPU timings, empty without a profiler
+    std::vector<GpuSampleStats> counters; // samples passed per frame of each sample counter, reported as overdraw
+};
+
+class Benchmark
+{
+public:
+    // run configuration
+    int measuredFrames;
+    int warmupFrames;
+    std::string outputPath;
+    // report metadata
+    std::string renderer;
+    unsigned int width = 0;
+    unsigned int height = 0;
+
+    // current state of the run
+    bool running = false;
+    std::string variant; // set by the caller every frame to the AO permutation in use
+    int currentPreset = 0;
+    int currentAOSetting = 0;
+    std::vector<BenchmarkResult> results;
+
+    Benchmark(int measuredFrames = 300, int warmupFrames = 30, const std::string& outputPath = "benchmark.json")
+        : measuredFrames(measuredFrames), warmupFrames(warmupFrames), outputPath(outputPath)
+    {
+    }
+
+    // starts a new run over presetCount camera presets and every named AO setting
+    void start(int presetCount, const std::vector<std::string>& settingNames)
+    {
+        this->presetCount = presetCount;
+        this->settingNames = settingNames;
+        results.clear();
+        currentPreset = 0;
+        currentAOSetting = 0;
+        running = presetCount > 0 && !settingNames.empty();
+        // the first frame always goes, it still carries the model/texture load or the previous case's switch
+        warmupFrames = std::max(1, warmupFrames);
+        resetCase();
+    }
+
+    // records the time of one rendered frame (in seconds).
+    // returns true when the runner moved on to a new preset/AO setting (or finished),
+    // so the caller knows to apply the new state before rendering the next frame.
+    // when a profiler is given, its per-pass timings over the measured frames go into the results.
+    bool update(float frameTime, GpuProfiler* profiler = nullptr)
+    {
+        if (!running)
+            return false;
+
+        frameIndex++;
+        if (frameIndex <= warmupFrames)
+            return false;
+        if (frameIndex == warmupFrames + 1 && profiler)
+            profiler->beginCapture();
+
+        frameTimes.push_back(frameTime * 1000.0f);
+        if ((int)frameTimes.size() < measuredFrames)
+            return false;
+
+        finishCase(profiler);
+
+        // move to the next AO setting, then to the next camera preset
+        currentAOSetting++;
+        if (currentAOSetting >= (int)settingNames.size())
+        {
+            currentAOSetting = 0;
+            currentPreset++;
+            if (currentPreset >= presetCount)
+            {
+                running = false;
+                std::cout << "All tests complete." << std::endl;
+                return true;
+            }
+        }
+        resetCase();
+        return true;
+    }
+
+    // writes the collected results to outputPath, as CSV if it ends in .csv and JSON otherwise
+    bool writeReport() const
+    {
+        std::ofstream file(outputPath);
+        if (!file.is_open())
+        {
+            std::cerr << "Unable to open benchmark report: " << outputPath << std::endl;
+            return false;
+        }
+        bool csv = outputPath.size() >= 4 && outputPath.compare(outputPath.size() - 4, 4, ".csv") == 0;
+        if (csv)
+            writeCSV(file);
+        else
+            writeJSON(file);
+        std::cout << "Benchmark report written to " << outputPath << std::endl;
+        return true;
+    }
+
+private:
+    int presetCount = 0;
+    std::vector<std::string> settingNames;
+    int frameIndex = 0;
+    std::vector<float> frameTimes; // milliseconds
+
+    void resetCase()
+    {
+        frameIndex = 0;
+        frameTimes.clear();
+        frameTimes.reserve(measuredFrames);
+    }
+
+    void finishCase(GpuProfiler* profiler)
+    {
+        BenchmarkResult result;
+        result.preset = currentPreset;
+        result.aoSetting = currentAOSetting;
+        result.aoName = settingNames[currentAOSetting];
+        result.variant = variant;
+        result.frames = (int)frameTimes.size();
+
+        float sum = 0.0f;
+        for (float t : frameTimes)
+            sum += t;
+        std::vector<float> sorted = frameTimes;
+        std::sort(sorted.begin(), sorted.end());
+        result.avgFrameMs = sum / result.frames;
+        result.minFrameMs = sorted.front();
+        result.maxFrameMs = sorted.back();
+        result.p99FrameMs = sorted[std::min(sorted.size() - 1, (size_t)(sorted.size() * 0.99f))];
+        result.avgFPS = 1000.0f / result.avgFrameMs;
+        if (profiler)
+        {
+            result.counters = profiler->capturedSampleStats();
+            result.passes = profiler->endCapture();
+        }
+        results.push_back(result);
+
+        std::cout << "Camera Preset " << result.preset << ", AO Setting " << result.aoName
+            << (result.variant.empty() ? "" : " [" + result.variant + "]") << ": "
+            << result.avgFPS << " FPS (" << result.avgFrameMs << " ms)" << std::endl;
+    }
+
+    // samples passed per screen pixel
+    double overdraw(const GpuSampleStats& counter) const
+    {
+        return width && height ? counter.avgSamples / ((double)width * height) : 0.0;
+    }
+
+    static std::string escape(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    void writeJSON(std::ostream& out) const
+    {
+        out << "{\n";
+        out << "  \"renderer\": \"" << escape(renderer) << "\",\n";
+        out << "  \"width\": " << width << ",\n";
+        out << "  \"height\": " << height << ",\n";
+        out << "  \"warmupFrames\": " << warmupFrames << ",\n";
+        out << "  \"measuredFrames\": " << measuredFrames << ",\n";
+        out << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const BenchmarkResult& r = results[i];
+            out << "    { \"preset\": " << r.preset
+                << ", \"ao\": \"" << escape(r.aoName) << "\""
+                << ", \"variant\": \"" << escape(r.variant) << "\""
+                << ", \"frames\": " << r.frames
+                << ", \"avgMs\": " << r.avgFrameMs
+                << ", \"minMs\": " << r.minFrameMs
+                << ", \"maxMs\": " << r.maxFrameMs
+                << ", \"p99Ms\": " << r.p99FrameMs
+                << ", \"avgFPS\": " << r.avgFPS
+                << ", \"passes\": [";
+            for (size_t j = 0; j < r.passes.size(); j++)
+            {
+                const GpuPassStats& pass = r.passes[j];
+                out << (j > 0 ? ", " : "")
+                    << "{ \"name\": \"" << escape(pass.name) << "\""
+                    << ", \"avgMs\": " << pass.avgMs
+                    << ", \"minMs\": " << pass.minMs
+                    << ", \"p99Ms\": " << pass.p99Ms << " }";
+            }
+            out << "], \"overdraw\": [";
+            for (size_t j = 0; j < r.counters.size(); j++)
+            {
+                const GpuSampleStats& counter = r.counters[j];
+                out << (j > 0 ? ", " : "")
+                    << "{ \"name\": \"" << escape(counter.name) << "\""
+                    << ", \"factor\": " << overdraw(counter) << " }";
+            }
+            out << "] }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n";
+        out << "}\n";
+    }
+
+    // one column per pass and per sample counter seen in any result, left empty where a case didn't run it
+    void writeCSV(std::ostream& out) const
+    {
+        std::vector<std::string> passNames, counterNames;
+        for (const BenchmarkResult& r : results)
+        {
+            for (const GpuPassStats& pass : r.passes)
+                if (std::find(passNames.begin(), passNames.end(), pass.name) == passNames.end())
+                    passNames.push_back(pass.name);
+            for (const GpuSampleStats& counter : r.counters)
+                if (std::find(counterNames.begin(), counterNames.end(), counter.name) == counterNames.end())
+                    counterNames.push_back(counter.name);
+        }
+
+        out << "preset,ao,variant,frames,avg_ms,min_ms,max_ms,p99_ms,avg_fps";
+        for (const std::string& name : passNames)
+            out << ",gpu_" << name << "_avg_ms";
+        for (const std::string& name : counterNames)
+            out << ",overdraw_" << name;
+        out << "\n";
+        for (const BenchmarkResult& r : results)
+        {
+            out << r.preset << "," << r.aoName << "," << r.variant << "," << r.frames << ","
+                << r.avgFrameMs << "," << r.minFrameMs << "," << r.maxFrameMs << ","
+                << r.p99FrameMs << "," << r.avgFPS;
+            for (const std::string& name : passNames)
+            {
+                out << ",";
+                for (const GpuPassStats& pass : r.passes)
+                    if (pass.name == name)
+                        out << pass.avgMs;
+            }
+            for (const std::string& name : counterNames)
+            {
+                out << ",";
+                for (const GpuSampleStats& counter : r.counters)
+                    if (counter.name == name)
+                        out << overdraw(counter);
+            }
+            out << "\n";
+        }
+    }
+};
+#endif
@@ -0,0 +1,21 @@
+#version 330 core
+
+/*
+Builds one level of the linear depth pyramid from the level above it
+Rotated grid subsampling from Scalable Ambient Obscurance (McGuire et al., 2012)
+https://research.nvidia.com/publication/2012-06_scalable-ambient-obscurance
+Keeps a real depth value per texel (no averaging across edges)
+*/
+
+out float FragColor;
+
+// the previous level is the texture's only accessible level (base level = max level)
+uniform sampler2D depthInput;
+
+void main()
+{
+    ivec2 ssP = ivec2(gl_FragCoord.xy);
+    ivec2 inputSize = textureSize(depthInput, 0);
+    ivec2 sourceP = clamp(ssP * 2 + ivec2(ssP.y & 1, ssP.x & 1), ivec2(0), inputSize - ivec2(1));
+    FragColor = texelFetch(depthInput, sourceP, 0).r;
+}
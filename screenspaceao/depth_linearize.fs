@@ -0,0 +1,16 @@
+#version 330 core
+
+/*
+Writes positive linear view-space depth into level 0 of the depth pyramid
+*/
+
+out float FragColor;
+
+in vec2 TexCoords;
+
+#include "gbuffer.glsl"
+
+void main()
+{
+    FragColor = -getViewPosition(TexCoords).z;
+}
@@ -0,0 +1,9 @@
+#version 330 core
+
+/*
+Depth pre-pass, only depth is written (colour writes are masked off by the caller)
+*/
+
+void main()
+{
+}
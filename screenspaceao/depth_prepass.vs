@@ -0,0 +1,21 @@
+#version 330 core
+
+/*
+Depth pre-pass over the position stream alone
+gl_Position is computed exactly like ssao_geometry.vs and declared invariant in both, so the
+geometry pass can test against this depth with GL_EQUAL
+*/
+
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+
+#include "frame_uniforms.glsl"
+
+invariant gl_Position;
+
+void main()
+{
+    vec4 viewPos = view * model * vec4(aPos, 1.0);
+    gl_Position = projection * viewPos;
+}
@@ -0,0 +1,47 @@
+#ifndef FILE_STAMP_H
+#define FILE_STAMP_H
+
+/*
+Size and modification time of a file, what the mesh cache and cooked textures record of the file they
+were built from so they are rebuilt once it changes
+*/
+
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// time is in the finest unit the platform keeps (100 ns on Windows, nanoseconds elsewhere) and is only meant
+// to be compared, whole seconds would miss a file rewritten within the second the cache was built from it
+inline bool fileStamp(const std::string& path, std::uint64_t& size, std::int64_t& time)
+{
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &info))
+        return false;
+    size = ((std::uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+    time = (std::int64_t)(((std::uint64_t)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime);
+#else
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+        return false;
+    size = (std::uint64_t)info.st_size;
+#ifdef __APPLE__
+    time = (std::int64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+    time = (std::int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+#endif
+    return true;
+}
+#endif
@@ -0,0 +1,12 @@
+/*
+Per-frame camera constants, one std140 uniform buffer shared by every program
+(C++ mirror: FrameUniforms in uniform_buffers.h)
+*/
+
+layout(std140) uniform FrameUniforms {
+    mat4 view;
+    mat4 projection;
+    mat4 invView;
+    mat4 invProjection;
+    vec3 viewPos; // camera's world-space position
+};
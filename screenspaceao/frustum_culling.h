@@ -0,0 +1,167 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+/*
+Frustum culling of axis-aligned bounding boxes
+Boxes are stored as centres and half extents in separate arrays (structure of arrays), so the test
+runs on 8 boxes per iteration with AVX, 4 with SSE and falls back to scalar code elsewhere. A box is
+visible unless it lies entirely behind one of the six planes taken from a model-view-projection
+matrix (Gribb and Hartmann), conservative near the frustum's corners. Ranges of boxes can be tested on
+their own, which is how the scene BVH (scene_bvh.h) tests the boxes of the leaves it can't decide
+*/
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <initializer_list>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULLING_AVX
+#elif defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLING_SSE
+#endif
+
+// the six planes of a model-view-projection matrix, inside where dot(plane.xyz, p) + plane.w >= 0
+struct FrustumPlanes {
+    float planes[6][4];
+
+    explicit FrustumPlanes(const glm::mat4& matrix)
+    {
+        for (int i = 0; i < 3; i++)
+            for (int c = 0; c < 4; c++)
+            {
+                planes[i * 2][c] = matrix[c][3] + matrix[c][i];
+                planes[i * 2 + 1][c] = matrix[c][3] - matrix[c][i];
+            }
+    }
+
+    // -1 when the box is fully outside, 1 when fully inside, 0 when it crosses a plane
+    int classify(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const
+    {
+        glm::vec3 centre = (boundsMin + boundsMax) * 0.5f, extent = (boundsMax - boundsMin) * 0.5f;
+        int side = 1;
+        for (const float* plane : planes)
+        {
+            float distance = plane[0] * centre.x + plane[1] * centre.y + plane[2] * centre.z + plane[3];
+            float radius = std::fabs(plane[0]) * extent.x + std::fabs(plane[1]) * extent.y + std::fabs(plane[2]) * extent.z;
+            if (distance + radius < 0.0f)
+                return -1;
+            if (distance - radius < 0.0f)
+                side = 0;
+        }
+        return side;
+    }
+};
+
+// boxes padded by at least 8 entries so the vector loop never reads past the arrays
+class BoundsArray
+{
+public:
+    void add(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+    {
+        if (size + 8 > capacity())
+            grow();
+        glm::vec3 centre = (boundsMin + boundsMax) * 0.5f, extent = (boundsMax - boundsMin) * 0.5f;
+        centreX[size] = centre.x;
+        centreY[size] = centre.y;
+        centreZ[size] = centre.z;
+        extentX[size] = extent.x;
+        extentY[size] = extent.y;
+        extentZ[size] = extent.z;
+        size++;
+    }
+
+    size_t count() const
+    {
+        return size;
+    }
+
+    void clear()
+    {
+        size = 0;
+    }
+
+    // sets visible[i] to 1 for every box inside or crossing the frustum of matrix, 0 for the rest
+    void cull(const glm::mat4& matrix, unsigned char* visible) const
+    {
+        cull(FrustumPlanes(matrix), 0, size, visible);
+    }
+
+    // the same for boxes [begin, end) only
+    void cull(const FrustumPlanes& frustum, size_t begin, size_t end, unsigned char* visible) const
+    {
+        const float(&planes)[6][4] = frustum.planes;
+        size_t i = begin;
+#if defined(FRUSTUM_CULLING_AVX)
+        for (; i < end; i += 8)
+        {
+            __m256 cx = _mm256_loadu_ps(&centreX[i]), cy = _mm256_loadu_ps(&centreY[i]), cz = _mm256_loadu_ps(&centreZ[i]);
+            __m256 ex = _mm256_loadu_ps(&extentX[i]), ey = _mm256_loadu_ps(&extentY[i]), ez = _mm256_loadu_ps(&extentZ[i]);
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (const float* plane : planes)
+            {
+                // signed distance of the centre plus the box's projected radius, negative when fully outside
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[0]), cx), _mm256_mul_ps(_mm256_set1_ps(plane[1]), cy)),
+                    _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[2]), cz), _mm256_set1_ps(plane[3])));
+                __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::fabs(plane[0])), ex), _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane[1])), ey)),
+                    _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane[2])), ez));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+            }
+            int mask = _mm256_movemask_ps(inside);
+            for (size_t lane = 0; lane < 8 && i + lane < end; lane++)
+                visible[i + lane] = (mask >> lane) & 1;
+        }
+#elif defined(FRUSTUM_CULLING_SSE)
+        for (; i < end; i += 4)
+        {
+            __m128 cx = _mm_loadu_ps(&centreX[i]), cy = _mm_loadu_ps(&centreY[i]), cz = _mm_loadu_ps(&centreZ[i]);
+            __m128 ex = _mm_loadu_ps(&extentX[i]), ey = _mm_loadu_ps(&extentY[i]), ez = _mm_loadu_ps(&extentZ[i]);
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (const float* plane : planes)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), cx), _mm_mul_ps(_mm_set1_ps(plane[1]), cy)),
+                    _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[2]), cz), _mm_set1_ps(plane[3])));
+                __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(plane[0])), ex), _mm_mul_ps(_mm_set1_ps(std::fabs(plane[1])), ey)),
+                    _mm_mul_ps(_mm_set1_ps(std::fabs(plane[2])), ez));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+            }
+            int mask = _mm_movemask_ps(inside);
+            for (size_t lane = 0; lane < 4 && i + lane < end; lane++)
+                visible[i + lane] = (mask >> lane) & 1;
+        }
+#else
+        for (; i < end; i++)
+        {
+            bool inside = true;
+            for (const float* plane : planes)
+            {
+                float distance = plane[0] * centreX[i] + plane[1] * centreY[i] + plane[2] * centreZ[i] + plane[3];
+                float radius = std::fabs(plane[0]) * extentX[i] + std::fabs(plane[1]) * extentY[i] + std::fabs(plane[2]) * extentZ[i];
+                inside = inside && distance + radius >= 0.0f;
+            }
+            visible[i] = inside ? 1 : 0;
+        }
+#endif
+    }
+
+private:
+    std::vector<float> centreX, centreY, centreZ;
+    std::vector<float> extentX, extentY, extentZ;
+    size_t size = 0;
+
+    size_t capacity() const
+    {
+        return centreX.size();
+    }
+
+    void grow()
+    {
+        size_t grown = capacity() == 0 ? 16 : capacity() * 2;
+        for (std::vector<float>* array : { &centreX, &centreY, &centreZ, &extentX, &extentY, &extentZ })
+            array->resize(grown, 0.0f);
+    }
+};
+#endif
@@ -0,0 +1,266 @@
+/*
+Shared G-buffer access for the AO and lighting passes
+With RECONSTRUCT_POSITION the view-space position is rebuilt from the depth buffer
+and the inverse projection instead of being read from the gPosition target.
+With OCTAHEDRAL_NORMALS gNormal holds two channel octahedral-encoded normals.
+With DEPTH_PYRAMID AO taps read a linear-depth mip chain, picking the mip from the tap's
+screen-space distance (McGuire et al., 2012, Scalable Ambient Obscurance)
+https://research.nvidia.com/publication/2012-06_scalable-ambient-obscurance
+With DEINTERLEAVED the AO pass shades one of 16 quarter resolution layers, each holding every
+4th pixel of the G-buffer, and every tap reads that layer so neighbouring fragments fetch
+neighbouring texels (Bavoil, 2014, Deinterleaved Texturing for Cache-Efficient Interleaved Sampling)
+https://developer.nvidia.com/sites/default/files/akamai/gameworks/samples/DeinterleavedTexturing.pdf
+With COMPUTE_AO the AO pass is a compute shader (see ao_compute.glsl) whose workgroup loads its tile
+of linear depth and normals plus an apron into shared memory once, and taps landing inside the tile
+read shared memory instead of the G-buffer
+*/
+
+#include "normal_encoding.glsl"
+#include "frame_uniforms.glsl"
+
+uniform sampler2D gNormal;
+
+// view-space unit normal of the surface at uv
+vec3 getViewNormal(vec2 uv)
+{
+#ifdef OCTAHEDRAL_NORMALS
+    return decodeNormal(texture(gNormal, uv).rg);
+#else
+    return normalize(texture(gNormal, uv).rgb);
+#endif
+}
+
+#ifdef RECONSTRUCT_POSITION
+uniform sampler2D gDepth;
+
+// view-space position of the surface at uv
+vec3 getViewPosition(vec2 uv)
+{
+    float depth = texture(gDepth, uv).r;
+    vec4 clipPos = vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    vec4 viewPos = invProjection * clipPos;
+    return viewPos.xyz / viewPos.w;
+}
+
+// resolution of the G-buffer in pixels
+vec2 getGBufferSize()
+{
+    return vec2(textureSize(gDepth, 0));
+}
+#else
+uniform sampler2D gPosition;
+
+// view-space position of the surface at uv
+vec3 getViewPosition(vec2 uv)
+{
+    return texture(gPosition, uv).xyz;
+}
+
+// resolution of the G-buffer in pixels
+vec2 getGBufferSize()
+{
+    return vec2(textureSize(gPosition, 0));
+}
+#endif
+
+// view-space position at uv of a surface linearDepth units in front of the camera
+vec3 getViewPositionFromLinearDepth(vec2 uv, float linearDepth)
+{
+    vec4 nearPos = invProjection * vec4(uv * 2.0 - 1.0, -1.0, 1.0);
+    vec3 ray = nearPos.xyz / nearPos.w;
+    return ray * (linearDepth / -ray.z);
+}
+
+// per-frame rotation of the noise vectors and slot in the sample set, so temporal accumulation sees a
+// different sample pattern every frame. Tap i uses sample i * temporalSampleStride + temporalFrameSlot: strided
+// rather than consecutive, as the kernel grows outwards and every frame needs near and far taps
+// (rotation and slot stay 0 and the stride 1 without temporal AO)
+uniform float temporalRotation = 0.0;
+uniform int temporalFrameSlot = 0;
+uniform int temporalSampleStride = 1;
+
+// rotates a noise vector around the z axis by this frame's temporal rotation
+vec3 rotateNoise(vec3 noise)
+{
+    float c = cos(temporalRotation);
+    float s = sin(temporalRotation);
+    return vec3(c * noise.x - s * noise.y, s * noise.x + c * noise.y, noise.z);
+}
+
+#ifdef DEINTERLEAVED
+uniform sampler2DArray deinterleavedDepth;  // linear depth, one layer per 4x4 pixel offset
+uniform sampler2DArray deinterleavedNormal; // view-space normals, same layout
+uniform int deinterleaveLayer;
+
+// offset inside each 4x4 block of the G-buffer pixels this layer holds
+ivec2 getLayerOffset()
+{
+    return ivec2(deinterleaveLayer % 4, deinterleaveLayer / 4);
+}
+
+// view-space position of the pixel this AO fragment shades
+vec3 getCenterPosition(vec2 uv)
+{
+    float linearDepth = texelFetch(deinterleavedDepth, ivec3(ivec2(gl_FragCoord.xy), deinterleaveLayer), 0).r;
+    return getViewPositionFromLinearDepth(uv, linearDepth);
+}
+
+// view-space unit normal of the pixel this AO fragment shades
+vec3 getCenterNormal(vec2 uv)
+{
+    return texelFetch(deinterleavedNormal, ivec3(ivec2(gl_FragCoord.xy), deinterleaveLayer), 0).xyz;
+}
+
+// view-space position of an AO tap, snapped to the nearest pixel held by this layer
+vec3 getTapPosition(vec2 uv, float tapDistance)
+{
+    vec2 gBufferSize = getGBufferSize();
+    vec2 layerSize = vec2(textureSize(deinterleavedDepth, 0).xy);
+    vec2 offset = vec2(getLayerOffset());
+    vec2 layerPixel = clamp(floor((uv * gBufferSize - 0.5 - offset) / 4.0 + 0.5), vec2(0.0), layerSize - 1.0);
+    float linearDepth = texelFetch(deinterleavedDepth, ivec3(ivec2(layerPixel), deinterleaveLayer), 0).r;
+    vec2 snappedUV = (layerPixel * 4.0 + offset + 0.5) / gBufferSize;
+    return getViewPositionFromLinearDepth(snappedUV, linearDepth);
+}
+
+// every pixel of a layer shares the rotation of its noise cell, so the layer's taps stay coherent
+vec3 getNoise(sampler2D noiseTexture)
+{
+    ivec2 noiseSize = textureSize(noiseTexture, 0);
+    return rotateNoise(texelFetch(noiseTexture, getLayerOffset() % noiseSize, 0).xyz);
+}
+#else
+#ifdef DEPTH_PYRAMID
+uniform sampler2D depthPyramid;
+
+// taps closer than 2^LOG_MAX_OFFSET pixels read the full resolution level
+const int LOG_MAX_OFFSET = 3;
+const int MAX_MIP_LEVEL = 5;
+
+// view-space position of an AO tap tapDistance pixels away from the shaded pixel, read from the G-buffer
+vec3 sampleTapPosition(vec2 uv, float tapDistance)
+{
+    int mip = clamp(int(floor(log2(max(tapDistance, 1.0)))) - LOG_MAX_OFFSET, 0, MAX_MIP_LEVEL);
+    float linearDepth = textureLod(depthPyramid, uv, float(mip)).r;
+    return getViewPositionFromLinearDepth(uv, linearDepth);
+}
+#else
+// view-space position of an AO tap tapDistance pixels away from the shaded pixel, read from the G-buffer
+vec3 sampleTapPosition(vec2 uv, float tapDistance)
+{
+    return getViewPosition(uv);
+}
+#endif
+
+#ifdef COMPUTE_AO
+// each workgroup shades a TILE_SIZE x TILE_SIZE block of AO pixels, and its shared tile extends
+// TILE_APRON pixels past it on every side (TILE_SIZE matches COMPUTE_TILE_SIZE in main.cpp)
+const int TILE_SIZE = 16;
+const int TILE_APRON = 8;
+const int TILE_REGION = TILE_SIZE + 2 * TILE_APRON;
+// a fused blur needs the AO of BLUR_APRON pixels around the block (matches COMPUTE_BLUR_APRON in main.cpp)
+const int BLUR_APRON = 4;
+const int BLUR_REGION = TILE_SIZE + 2 * BLUR_APRON;
+
+shared float tileDepth[TILE_REGION * TILE_REGION];  // linear depth, whole tile
+shared vec3 tileNormal[BLUR_REGION * BLUR_REGION];  // view-space normals, only where AO gets evaluated
+
+ivec2 aoSize;     // size of the AO target in pixels
+ivec2 tileOrigin; // AO pixel held by the first texel of the shared tile
+ivec2 aoPixel;    // AO pixel the invocation is currently evaluating
+
+// G-buffer uv at the centre of an AO pixel
+vec2 getAOPixelUV(ivec2 pixel)
+{
+    return (vec2(pixel) + 0.5) / vec2(aoSize);
+}
+
+// fills the shared tile of the workgroup's block from the G-buffer, sampled at AO pixel centres
+// so the tile also works below G-buffer resolution; out of screen texels repeat the edge
+void loadTile()
+{
+    tileOrigin = ivec2(gl_WorkGroupID.xy) * TILE_SIZE - TILE_APRON;
+    for (int i = int(gl_LocalInvocationIndex); i < TILE_REGION * TILE_REGION; i += TILE_SIZE * TILE_SIZE)
+    {
+        ivec2 pixel = clamp(tileOrigin + ivec2(i % TILE_REGION, i / TILE_REGION), ivec2(0), aoSize - 1);
+        tileDepth[i] = -getViewPosition(getAOPixelUV(pixel)).z;
+    }
+    for (int i = int(gl_LocalInvocationIndex); i < BLUR_REGION * BLUR_REGION; i += TILE_SIZE * TILE_SIZE)
+    {
+        ivec2 pixel = clamp(tileOrigin + TILE_APRON - BLUR_APRON + ivec2(i % BLUR_REGION, i / BLUR_REGION), ivec2(0), aoSize - 1);
+        tileNormal[i] = getViewNormal(getAOPixelUV(pixel));
+    }
+    barrier();
+}
+
+// linear depth of an AO pixel inside the shared tile
+float getTileDepth(ivec2 pixel)
+{
+    ivec2 local = pixel - tileOrigin;
+    return tileDepth[local.y * TILE_REGION + local.x];
+}
+
+// view-space normal of an AO pixel no further than BLUR_APRON from the workgroup's block
+vec3 getTileNormal(ivec2 pixel)
+{
+    ivec2 local = pixel - tileOrigin - (TILE_APRON - BLUR_APRON);
+    return tileNormal[local.y * BLUR_REGION + local.x];
+}
+
+// view-space position of the pixel this AO invocation shades
+vec3 getCenterPosition(vec2 uv)
+{
+    return getViewPositionFromLinearDepth(uv, getTileDepth(aoPixel));
+}
+
+// view-space unit normal of the pixel this AO invocation shades
+vec3 getCenterNormal(vec2 uv)
+{
+    return getTileNormal(aoPixel);
+}
+
+// view-space position of an AO tap, from the shared tile when it lands inside it (snapped to the
+// AO pixel's centre) and from the G-buffer otherwise
+vec3 getTapPosition(vec2 uv, float tapDistance)
+{
+    ivec2 pixel = ivec2(floor(uv * vec2(aoSize)));
+    ivec2 local = pixel - tileOrigin;
+    if (any(lessThan(local, ivec2(0))) || any(greaterThanEqual(local, ivec2(TILE_REGION))))
+        return sampleTapPosition(uv, tapDistance);
+    return getViewPositionFromLinearDepth(getAOPixelUV(pixel), getTileDepth(pixel));
+}
+
+// rotation vector for this AO pixel, the noise texture tiles once per noise-sized block of AO pixels
+vec3 getNoise(sampler2D noiseTexture)
+{
+    ivec2 noiseSize = textureSize(noiseTexture, 0);
+    return rotateNoise(texelFetch(noiseTexture, aoPixel % noiseSize, 0).xyz);
+}
+#else
+// view-space position of the pixel this AO fragment shades
+vec3 getCenterPosition(vec2 uv)
+{
+    return getViewPosition(uv);
+}
+
+// view-space unit normal of the pixel this AO fragment shades
+vec3 getCenterNormal(vec2 uv)
+{
+    return getViewNormal(uv);
+}
+
+// view-space position of an AO tap tapDistance pixels away from the shaded pixel
+vec3 getTapPosition(vec2 uv, float tapDistance)
+{
+    return sampleTapPosition(uv, tapDistance);
+}
+
+// rotation vector for this AO pixel, the noise texture tiles once per noise-sized block of output pixels
+// (indexing by output pixel keeps the full pattern when AO runs below G-buffer resolution)
+vec3 getNoise(sampler2D noiseTexture)
+{
+    ivec2 noiseSize = textureSize(noiseTexture, 0);
+    return rotateNoise(texelFetch(noiseTexture, ivec2(gl_FragCoord.xy) % noiseSize, 0).xyz);
+}
+#endif
+#endif
\ No newline at end of file
@@ -0,0 +1,143 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+/*
+OpenGL entry points past the 3.3 core profile glad was generated for
+Loaded at runtime once a context exists, each feature flag is only set when the context
+version provides it and every one of its functions resolved, so callers fall back otherwise
+*/
+
+#include <glad/glad.h>
+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_TEXTURE_FETCH_BARRIER_BIT
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#endif
+#ifndef GL_FRAMEBUFFER_BARRIER_BIT
+#define GL_FRAMEBUFFER_BARRIER_BIT 0x00000400
+#endif
+#ifndef GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#endif
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+#include <cstring>
+
+typedef void (APIENTRYP PFNDISPATCHCOMPUTEPROC)(GLuint numGroupsX, GLuint numGroupsY, GLuint numGroupsZ);
+typedef void (APIENTRYP PFNBINDIMAGETEXTUREPROC)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+typedef void (APIENTRYP PFNMEMORYBARRIERPROC)(GLbitfield barriers);
+typedef void (APIENTRYP PFNGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+typedef void (APIENTRYP PFNMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+typedef void (APIENTRYP PFNBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+struct GLExtensions {
+    // GL 4.3 compute shaders with image load/store
+    bool computeShaders = false;
+    PFNDISPATCHCOMPUTEPROC dispatchCompute = nullptr;
+    PFNBINDIMAGETEXTUREPROC bindImageTexture = nullptr;
+    PFNMEMORYBARRIERPROC memoryBarrier = nullptr;
+
+    // GL 4.1 (or ARB_get_program_binary) program binaries, needs at least one binary format
+    bool programBinaries = false;
+    PFNGETPROGRAMBINARYPROC getProgramBinary = nullptr;
+    PFNPROGRAMBINARYPROC programBinary = nullptr;
+    PFNPROGRAMPARAMETERIPROC programParameteri = nullptr;
+
+    // KHR/ARB_parallel_shader_compile, compiles and links run in the background until GL_COMPLETION_STATUS_KHR is queried true
+    bool parallelShaderCompile = false;
+    PFNMAXSHADERCOMPILERTHREADSPROC maxShaderCompilerThreads = nullptr;
+
+    // GL 4.4 (or ARB_buffer_storage) immutable buffers, used for persistently mapped upload buffers
+    bool persistentMapping = false;
+    PFNBUFFERSTORAGEPROC bufferStorage = nullptr;
+
+    // GL 4.3 (or ARB_multi_draw_indirect) batches of draws read from a command buffer
+    bool multiDrawIndirect = false;
+    PFNMULTIDRAWELEMENTSINDIRECTPROC multiDrawElementsIndirect = nullptr;
+
+    // EXT_texture_compression_s3tc, BC1-3 textures (BC4/5 are core RGTC)
+    bool textureCompressionS3TC = false;
+
+    // resolves every entry point the current context's version provides
+    void load(GLADloadproc loader)
+    {
+        if (hasVersion(4, 3))
+        {
+            dispatchCompute = (PFNDISPATCHCOMPUTEPROC)loader("glDispatchCompute");
+            bindImageTexture = (PFNBINDIMAGETEXTUREPROC)loader("glBindImageTexture");
+            memoryBarrier = (PFNMEMORYBARRIERPROC)loader("glMemoryBarrier");
+            computeShaders = dispatchCompute && bindImageTexture && memoryBarrier;
+        }
+        if (hasVersion(4, 1) || hasExtension("GL_ARB_get_program_binary"))
+        {
+            getProgramBinary = (PFNGETPROGRAMBINARYPROC)loader("glGetProgramBinary");
+            programBinary = (PFNPROGRAMBINARYPROC)loader("glProgramBinary");
+            programParameteri = (PFNPROGRAMPARAMETERIPROC)loader("glProgramParameteri");
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            programBinaries = getProgramBinary && programBinary && programParameteri && formats > 0;
+        }
+        if (hasExtension("GL_KHR_parallel_shader_compile"))
+            maxShaderCompilerThreads = (PFNMAXSHADERCOMPILERTHREADSPROC)loader("glMaxShaderCompilerThreadsKHR");
+        else if (hasExtension("GL_ARB_parallel_shader_compile"))
+            maxShaderCompilerThreads = (PFNMAXSHADERCOMPILERTHREADSPROC)loader("glMaxShaderCompilerThreadsARB");
+        parallelShaderCompile = maxShaderCompilerThreads != nullptr;
+        if (hasVersion(4, 4) || hasExtension("GL_ARB_buffer_storage"))
+            bufferStorage = (PFNBUFFERSTORAGEPROC)loader("glBufferStorage");
+        persistentMapping = bufferStorage != nullptr;
+        if (hasVersion(4, 3) || hasExtension("GL_ARB_multi_draw_indirect"))
+            multiDrawElementsIndirect = (PFNMULTIDRAWELEMENTSINDIRECTPROC)loader("glMultiDrawElementsIndirect");
+        multiDrawIndirect = multiDrawElementsIndirect != nullptr;
+        textureCompressionS3TC = hasExtension("GL_EXT_texture_compression_s3tc");
+    }
+
+    static bool hasVersion(int major, int minor)
+    {
+        return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+    }
+
+    static bool hasExtension(const char* name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+            if (extension && std::strcmp(extension, name) == 0)
+                return true;
+        }
+        return false;
+    }
+};
+#endif
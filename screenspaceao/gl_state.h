@@ -0,0 +1,136 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+/*
+Cache of the GL bindings draw submission changes, skipping calls that would rebind what is already bound
+Programs are always bound through it (Shader::use), so the current program is known for the whole frame.
+Texture units and the vertex array are also bound directly by the passes in main.cpp, the cache only
+trusts them after invalidateBindings(), which Model::Draw calls before submitting
+Issued and skipped calls are counted per frame for the GUI
+*/
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <unordered_map>
+
+enum GLStateCall {
+    STATE_PROGRAM,
+    STATE_ACTIVE_TEXTURE,
+    STATE_TEXTURE,
+    STATE_VERTEX_ARRAY,
+    STATE_SAMPLER_UNIFORM,
+    STATE_CALL_COUNT
+};
+
+class GLStateCache
+{
+public:
+    static const int MAX_TEXTURE_UNITS = 32;
+
+    struct Counters {
+        int issued[STATE_CALL_COUNT] = {};
+        int skipped[STATE_CALL_COUNT] = {};
+    };
+
+    GLStateCache()
+    {
+        invalidateBindings();
+    }
+
+    void useProgram(GLuint program)
+    {
+        if (count(STATE_PROGRAM, program == currentProgram))
+            return;
+        glUseProgram(program);
+        currentProgram = program;
+    }
+
+    void activeTexture(int unit)
+    {
+        if (count(STATE_ACTIVE_TEXTURE, unit == currentUnit))
+            return;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        currentUnit = unit;
+    }
+
+    // binds a 2D texture to unit, switching the active unit only when the binding changes
+    void bindTexture(int unit, GLuint texture)
+    {
+        bool bound = unit < MAX_TEXTURE_UNITS && textures[unit] == texture;
+        if (count(STATE_TEXTURE, bound))
+            return;
+        activeTexture(unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        if (unit < MAX_TEXTURE_UNITS)
+            textures[unit] = texture;
+    }
+
+    void bindVertexArray(GLuint vertexArray)
+    {
+        if (count(STATE_VERTEX_ARRAY, vertexArray == currentVertexArray))
+            return;
+        glBindVertexArray(vertexArray);
+        currentVertexArray = vertexArray;
+    }
+
+    // points a sampler uniform of program, which must be current, at unit
+    // only for samplers nothing else sets, their values are remembered for as long as the program lives
+    void setSampler(GLuint program, GLint location, int unit)
+    {
+        if (location < 0)
+            return;
+        std::uint64_t key = (std::uint64_t)program << 32 | (std::uint32_t)location;
+        auto found = samplerUnits.find(key);
+        if (count(STATE_SAMPLER_UNIFORM, found != samplerUnits.end() && found->second == unit))
+            return;
+        glUniform1i(location, unit);
+        samplerUnits[key] = unit;
+    }
+
+    // forgets the texture and vertex array bindings, after code outside the cache may have changed them
+    void invalidateBindings()
+    {
+        currentUnit = UNKNOWN;
+        currentVertexArray = UNKNOWN;
+        for (GLuint& texture : textures)
+            texture = UNKNOWN;
+    }
+
+    // starts counting a new frame, lastFrame() keeps the previous one
+    void beginFrame()
+    {
+        previous = current;
+        current = Counters();
+    }
+
+    const Counters& lastFrame() const
+    {
+        return previous;
+    }
+
+private:
+    static const GLuint UNKNOWN = 0xFFFFFFFF;
+
+    GLuint currentProgram = 0;
+    int currentUnit = (int)UNKNOWN;
+    GLuint currentVertexArray = UNKNOWN;
+    GLuint textures[MAX_TEXTURE_UNITS];
+    std::unordered_map<std::uint64_t, int> samplerUnits; // program << 32 | location
+    Counters current, previous;
+
+    // records a call as skipped when redundant, returns redundant
+    bool count(GLStateCall call, bool redundant)
+    {
+        (redundant ? current.skipped : current.issued)[call]++;
+        return redundant;
+    }
+};
+
+// the state cache of the one context
+inline GLStateCache& glState()
+{
+    static GLStateCache cache;
+    return cache;
+}
+#endif
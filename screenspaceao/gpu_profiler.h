@@ -0,0 +1,398 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+/*
+Per-pass GPU profiler using GL_TIMESTAMP queries
+Each frame writes its begin/end timestamps into one slot of a ring of in-flight query sets,
+results are only read back once GL_QUERY_RESULT_AVAILABLE says so, so the pipeline never stalls
+Named sample counters (GL_SAMPLES_PASSED) go through the same ring, e.g. to measure overdraw
+*/
+
+#include <glad/glad.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// rolling statistics of a single pass, in milliseconds
+struct GpuPassStats {
+    std::string name;
+    float lastMs;
+    float minMs;
+    float avgMs;
+    float p99Ms;
+};
+
+// rolling average of a sample counter, in samples passed per frame
+struct GpuSampleStats {
+    std::string name;
+    double lastSamples;
+    double avgSamples;
+};
+
+class GpuProfiler
+{
+public:
+    // latency: number of frames that can be in flight before a slot is reused
+    // historySize: number of frames the rolling statistics are computed over
+    GpuProfiler(int latency = 4, int historySize = 240) : historySize(historySize)
+    {
+        frames.resize(latency);
+    }
+
+    // starts recording a new frame, reading back (or dropping) whatever the reused slot still holds
+    void beginFrame()
+    {
+        frameIndex++;
+        FrameQueries& frame = frames[frameIndex % frames.size()];
+        if (frame.pending)
+        {
+            if (resultsAvailable(frame))
+                resolve(frame);
+            else
+                droppedFrames++; // never wait on the GPU, just lose this frame's timings
+            frame.pending = false;
+        }
+        frame.scopes.clear();
+        frame.openScopes.clear();
+        frame.usedQueries = 0;
+        frame.counts.clear();
+        frame.usedSampleQueries = 0;
+        frame.captured = capturing;
+        beginPass("Frame");
+    }
+
+    // marks the start of a named pass, passes may nest
+    void beginPass(const char* name)
+    {
+        FrameQueries& frame = frames[frameIndex % frames.size()];
+        Scope scope;
+        scope.pass = findPass(name);
+        scope.beginQuery = nextQuery(frame);
+        scope.endQuery = 0;
+        glQueryCounter(frame.queries[scope.beginQuery], GL_TIMESTAMP);
+        frame.openScopes.push_back((int)frame.scopes.size());
+        frame.scopes.push_back(scope);
+    }
+
+    // marks the end of the most recently started pass
+    void endPass()
+    {
+        FrameQueries& frame = frames[frameIndex % frames.size()];
+        if (frame.openScopes.empty())
+            return;
+        Scope& scope = frame.scopes[frame.openScopes.back()];
+        frame.openScopes.pop_back();
+        scope.endQuery = nextQuery(frame);
+        glQueryCounter(frame.queries[scope.endQuery], GL_TIMESTAMP);
+    }
+
+    // counts the samples passing the depth and stencil tests until endSampleCount, counts can't nest
+    void beginSampleCount(const char* name)
+    {
+        FrameQueries& frame = frames[frameIndex % frames.size()];
+        if (frame.counting)
+            return;
+        Count count;
+        count.counter = findCounter(name);
+        count.query = frame.usedSampleQueries++;
+        if (count.query == (int)frame.sampleQueries.size())
+        {
+            GLuint query;
+            glGenQueries(1, &query);
+            frame.sampleQueries.push_back(query);
+        }
+        glBeginQuery(GL_SAMPLES_PASSED, frame.sampleQueries[count.query]);
+        frame.counts.push_back(count);
+        frame.counting = true;
+    }
+
+    void endSampleCount()
+    {
+        FrameQueries& frame = frames[frameIndex % frames.size()];
+        if (!frame.counting)
+            return;
+        glEndQuery(GL_SAMPLES_PASSED);
+        frame.counting = false;
+    }
+
+    // closes the frame and reads back any earlier frames whose results have arrived
+    void endFrame()
+    {
+        FrameQueries& current = frames[frameIndex % frames.size()];
+        while (!current.openScopes.empty())
+            endPass();
+        endSampleCount();
+        current.pending = true;
+
+        // oldest first, so the history stays in frame order
+        for (size_t i = 1; i < frames.size(); i++)
+        {
+            FrameQueries& frame = frames[(frameIndex + i) % frames.size()];
+            if (frame.pending && resultsAvailable(frame))
+            {
+                resolve(frame);
+                frame.pending = false;
+            }
+        }
+    }
+
+    // rolling min/avg/p99 over the last historySize resolved frames, in first-seen pass order
+    std::vector<GpuPassStats> stats() const
+    {
+        std::vector<GpuPassStats> result;
+        for (const Pass& pass : passes)
+        {
+            if (pass.history.empty())
+                continue;
+            GpuPassStats passStats = computeStats(pass.history);
+            passStats.name = pass.name;
+            passStats.lastMs = pass.history[(pass.historyNext + pass.history.size() - 1) % pass.history.size()];
+            result.push_back(passStats);
+        }
+        return result;
+    }
+
+    // rolling average of every sample counter sampled in the latest resolved frame, over the frames since it
+    // started running or the last historySize
+    std::vector<GpuSampleStats> sampleStats() const
+    {
+        std::vector<GpuSampleStats> result;
+        for (const Counter& counter : counters)
+        {
+            if (counter.history.empty())
+                continue;
+            double sum = 0.0;
+            for (double samples : counter.history)
+                sum += samples;
+            GpuSampleStats stats;
+            stats.name = counter.name;
+            stats.lastSamples = counter.history[(counter.historyNext + counter.history.size() - 1) % counter.history.size()];
+            stats.avgSamples = sum / counter.history.size();
+            result.push_back(stats);
+        }
+        return result;
+    }
+
+    // starts collecting every resolved sample (not just the rolling window), used by the benchmark
+    // only frames begun from here on are captured, frames still in flight belong to whatever ran before
+    void beginCapture()
+    {
+        capturing = true;
+        for (Pass& pass : passes)
+            pass.captured.clear();
+        for (Counter& counter : counters)
+            counter.captured.clear();
+    }
+
+    // average of every sample counter over the frames captured so far, read before endCapture
+    std::vector<GpuSampleStats> capturedSampleStats() const
+    {
+        std::vector<GpuSampleStats> result;
+        for (const Counter& counter : counters)
+        {
+            if (counter.captured.empty())
+                continue;
+            double sum = 0.0;
+            for (double samples : counter.captured)
+                sum += samples;
+            GpuSampleStats stats;
+            stats.name = counter.name;
+            stats.lastSamples = counter.captured.back();
+            stats.avgSamples = sum / counter.captured.size();
+            result.push_back(stats);
+        }
+        return result;
+    }
+
+    // stops collecting and returns statistics over everything captured since beginCapture
+    std::vector<GpuPassStats> endCapture()
+    {
+        capturing = false;
+        for (FrameQueries& frame : frames)
+            frame.captured = false; // still in flight, too late for this capture and too early for the next
+        std::vector<GpuPassStats> result;
+        for (Pass& pass : passes)
+        {
+            if (pass.captured.empty())
+                continue;
+            GpuPassStats passStats = computeStats(pass.captured);
+            passStats.name = pass.name;
+            passStats.lastMs = pass.captured.back();
+            result.push_back(passStats);
+            pass.captured.clear();
+        }
+        for (Counter& counter : counters)
+            counter.captured.clear();
+        return result;
+    }
+
+    int getDroppedFrames() const
+    {
+        return droppedFrames;
+    }
+
+private:
+    struct Scope {
+        int pass;
+        int beginQuery;
+        int endQuery;
+    };
+
+    struct Count {
+        int counter;
+        int query;
+    };
+
+    struct FrameQueries {
+        std::vector<GLuint> queries;
+        int usedQueries = 0;
+        std::vector<Scope> scopes;
+        std::vector<int> openScopes;
+        // occlusion queries can't share objects with timestamps, so sample counts have their own pool
+        std::vector<GLuint> sampleQueries;
+        int usedSampleQueries = 0;
+        std::vector<Count> counts;
+        bool counting = false;
+        bool pending = false;
+        bool captured = false; // begun while capturing, so its timings and counts also go into the captured samples
+    };
+
+    struct Pass {
+        std::string name;
+        std::vector<float> history; // ring buffer of the last historySize samples
+        size_t historyNext = 0;
+        std::vector<float> captured;
+    };
+
+    struct Counter {
+        std::string name;
+        std::vector<double> history; // ring buffer like Pass::history
+        size_t historyNext = 0;
+        std::vector<double> captured;
+    };
+
+    std::vector<FrameQueries> frames;
+    std::vector<Pass> passes;
+    std::vector<Counter> counters;
+    size_t historySize;
+    size_t frameIndex = 0;
+    int droppedFrames = 0;
+    bool capturing = false;
+    mutable std::vector<float> scratch; // reused by computeStats so stats() doesn't allocate every frame
+
+    int findPass(const char* name)
+    {
+        for (size_t i = 0; i < passes.size(); i++)
+            if (passes[i].name == name)
+                return (int)i;
+        Pass pass;
+        pass.name = name;
+        pass.history.reserve(historySize);
+        passes.push_back(pass);
+        return (int)passes.size() - 1;
+    }
+
+    int findCounter(const char* name)
+    {
+        for (size_t i = 0; i < counters.size(); i++)
+            if (counters[i].name == name)
+                return (int)i;
+        Counter counter;
+        counter.name = name;
+        counter.history.reserve(historySize);
+        counters.push_back(counter);
+        return (int)counters.size() - 1;
+    }
+
+    // hands out the next query object of the frame, growing the pool the first time it is needed
+    int nextQuery(FrameQueries& frame)
+    {
+        if (frame.usedQueries == (int)frame.queries.size())
+        {
+            GLuint query;
+            glGenQueries(1, &query);
+            frame.queries.push_back(query);
+        }
+        return frame.usedQueries++;
+    }
+
+    // queries complete in order, so the last one being available means all of them are
+    bool resultsAvailable(const FrameQueries& frame) const
+    {
+        GLint available = 1;
+        if (frame.usedQueries > 0)
+            glGetQueryObjectiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available && frame.usedSampleQueries > 0)
+            glGetQueryObjectiv(frame.sampleQueries[frame.usedSampleQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        return available != 0;
+    }
+
+    void resolve(const FrameQueries& frame)
+    {
+        for (const Scope& scope : frame.scopes)
+        {
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(frame.queries[scope.beginQuery], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(frame.queries[scope.endQuery], GL_QUERY_RESULT, &end);
+            float ms = (float)((double)(end - begin) / 1000000.0);
+            addSample(passes[scope.pass], ms, frame.captured);
+        }
+        std::vector<bool> sampled(counters.size(), false);
+        for (const Count& count : frame.counts)
+        {
+            GLuint64 samples = 0;
+            glGetQueryObjectui64v(frame.sampleQueries[count.query], GL_QUERY_RESULT, &samples);
+            Counter& counter = counters[count.counter];
+            if (counter.history.size() < historySize)
+                counter.history.push_back((double)samples);
+            else
+                counter.history[counter.historyNext] = (double)samples;
+            counter.historyNext = (counter.historyNext + 1) % historySize;
+            if (frame.captured)
+                counter.captured.push_back((double)samples);
+            sampled[count.counter] = true;
+        }
+        // a counter whose pass stopped running is forgotten, so it neither lingers in sampleStats nor mixes
+        // its old samples into the average once the pass runs again
+        for (size_t i = 0; i < counters.size(); i++)
+            if (!sampled[i])
+            {
+                counters[i].history.clear();
+                counters[i].historyNext = 0;
+            }
+    }
+
+    void addSample(Pass& pass, float ms, bool capture)
+    {
+        if (pass.history.size() < historySize)
+            pass.history.push_back(ms);
+        else
+            pass.history[pass.historyNext] = ms;
+        pass.historyNext = (pass.historyNext + 1) % historySize;
+        if (capture)
+            pass.captured.push_back(ms);
+    }
+
+    // min and avg in one pass, p99 by partially ordering a copy, a full sort per pass per frame isn't needed
+    GpuPassStats computeStats(const std::vector<float>& samples) const
+    {
+        GpuPassStats result;
+        float sum = 0.0f;
+        float minMs = samples.front();
+        for (float s : samples)
+        {
+            sum += s;
+            minMs = std::min(minMs, s);
+        }
+        result.lastMs = 0.0f;
+        result.minMs = minMs;
+        result.avgMs = sum / samples.size();
+        scratch.assign(samples.begin(), samples.end());
+        std::vector<float>::iterator p99 = scratch.begin() + std::min(scratch.size() - 1, (size_t)(scratch.size() * 0.99f));
+        std::nth_element(scratch.begin(), p99, scratch.end());
+        result.p99Ms = *p99;
+        return result;
+    }
+};
+#endif
@@ -0,0 +1,114 @@
+/*
+Based on meemknight OpenGL implementation (meemknight, 2023)
+https://github.com/meemknight/gl3d/blob/master/src/shaders/hbao/hbao.frag
+Using Horizon Based Ambient Occlusion Method by NVIDIA
+https://developer.download.nvidia.com/presentations/2008/SIGGRAPH/HBAO_SIG08b.pdf
+(NVIDIA, 2008)
+Adjusted to work on this application and better visuals for this scene.
+Shared by the fragment (hbao.fs) and compute (hbao.comp) passes, include after gbuffer.glsl
+*/
+
+// Uniform samplers and variables for AO calculations
+uniform sampler2D texNoise;
+uniform float radius = 500000.f;
+uniform float bias = 0.f;
+// NUM_STEPS / NUM_DIRECTIONS permutations fix the march length and direction count at compile time
+#ifdef NUM_STEPS
+const int samples = NUM_STEPS;
+#else
+uniform int samples = 4;
+#endif
+#ifndef NUM_DIRECTIONS
+#define NUM_DIRECTIONS 4
+#endif
+
+const float INFINITY = 1.f/0.f;  // Define a constant for infinity
+const float PI = 3.14159265359;
+
+// Helper function to clamp a value between 0 and 1
+float saturate(float a)
+{
+	return min(max(a,0),1);
+}
+
+// Function to calculate Horizon Based Ambient Occlusion
+vec2 calculateAO(vec2 uv, vec3 normal, vec2 direction, vec2 screenSize, vec3 fragPos, float bias)
+{
+	float minRadius = 3.f;
+	float maxRadius = 100000.f;
+	float RAD = length(direction * vec2(radius) / (vec2(abs(fragPos.z)) * screenSize));
+	RAD = clamp(RAD, minRadius, maxRadius);
+
+	vec3 viewVector = normalize(fragPos);
+	vec3 leftDirection = cross(viewVector, vec3(direction, 0));
+	vec3 projectedNormal = normal - dot(leftDirection, normal) * leftDirection;
+	float projectedLen = length(projectedNormal);
+	projectedNormal /= projectedLen;
+
+	vec3 tangent = cross(projectedNormal, leftDirection);
+	float tangentAngle = atan(tangent.z / length(tangent.xy));
+	float sinTangentAngle = sin(tangentAngle + bias);
+	vec2 texelSize = vec2(1.f, 1.f) / screenSize;
+
+	float highestZ = -INFINITY;
+	vec3 foundPos = vec3(0, 0, -INFINITY);
+	
+	// Loop through the samples to perform ray marching
+	for(int i = 2; i <= samples; i++) 
+	{
+		vec2 marchPosition = uv + i * texelSize * direction;
+		vec3 fragPosMarch = getTapPosition(marchPosition, i * length(direction));
+		vec3 hVector = normalize(fragPosMarch - fragPos);
+
+		float rangeCheck = 1 - saturate(length(fragPosMarch - fragPos) / RAD);
+		hVector.z = mix(hVector.z, fragPos.z - RAD * 2, rangeCheck);
+
+		if(hVector.z > highestZ && length(fragPosMarch - fragPos) < RAD)
+		{
+			highestZ = hVector.z;
+			foundPos = fragPosMarch;
+		}
+	}
+
+	float rangeCheck = smoothstep(0.0, 1.0, 10 * length(screenSize) / length(foundPos - fragPos));
+	if(length(foundPos - fragPos) > length(screenSize) * 100) { rangeCheck = 0; }
+
+	vec3 horizonVector = (foundPos - fragPos);
+	float horizonAngle = atan(horizonVector.z / length(horizonVector.xy));
+	float sinHorizonAngle = sin(horizonAngle);	
+
+	vec2 result = vec2(saturate((sinHorizonAngle - sinTangentAngle)) / 2, projectedLen);
+	return result;
+}
+
+// ambient occlusion of the pixel at uv, 1 = unoccluded
+float computeAO(vec2 uv)
+{
+	vec2 screenSize = getGBufferSize();  // Get screen size
+
+	vec3 fragPos = getCenterPosition(uv);  // Sample fragment position
+	float adjusted_bias = (3.141592 / 360) * bias;
+	if(fragPos.z == -INFINITY) { return 1.0; }  // Handle edge case
+
+	vec3 normal = getCenterNormal(uv);  // Sample and normalize the normal
+	vec2 randomVec = normalize(getNoise(texNoise).xy);  // Sample and normalize random vector from noise texture
+
+	vec2 result = vec2(0, 0);
+	vec3 viewVector = normalize(fragPos);
+
+	// Perform AO calculations in NUM_DIRECTIONS directions evenly spread around the random vector,
+	// alternating between the adjusted and the raw bias (with four: +-randomVec adjusted, the perpendiculars raw)
+	for (int i = 0; i < NUM_DIRECTIONS; i++)
+	{
+		float angle = float(i) * (2.0 * PI / float(NUM_DIRECTIONS));
+		vec2 direction = mat2(cos(angle), sin(angle), -sin(angle), cos(angle)) * randomVec;
+		result += calculateAO(uv, normal, direction, screenSize, fragPos, i % 2 == 0 ? adjusted_bias : bias);
+	}
+	
+	result.x /= result.y;
+
+	float darknessFactor = 2.f; 
+    result.x *= darknessFactor;  // Apply a darkness factor
+	
+	return 1 - result.x;  // Final AO value (inverted)
+}
@@ -12,12 +12,21 @@ Including additions of preset cameras, lighting, UI, testing methods
 #include <glm/gtc/type_ptr.hpp>
 
 #include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/shader_s.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/shader_registry.h>
 #include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/camera.h>
 #include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/model.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/benchmark.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/gpu_profiler.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/normal_encoding.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/gl_extensions.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/uniform_buffers.h>
 
 #include <iostream>
 #include <random>
 #include <fstream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
 
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_glfw.h"
@@ -64,8 +73,9 @@ void initializeCameraPresets() {
 
 int currentPresetIndex = 0;
 
-void switchCameraPreset(Camera& camera) {
-    currentPresetIndex = (currentPresetIndex + 1) % cameraPresets.size();
+// moves the camera to the preset at the given index
+void applyCameraPreset(Camera& camera, int index) {
+    currentPresetIndex = index;
     std::cout << "Switching to camera preset index: " << currentPresetIndex << std::endl;
 
     const CameraPreset& preset = cameraPresets[currentPresetIndex];
@@ -77,6 +87,10 @@ void switchCameraPreset(Camera& camera) {
     camera.updateCameraVectors();
 }
 
+void switchCameraPreset(Camera& camera) {
+    applyCameraPreset(camera, (currentPresetIndex + 1) % cameraPresets.size());
+}
+
 // logs the current state of the camera
 void logCameraState(const Camera& camera) {
     std::ofstream logFile("camera_presets.log", std::ios::app);
@@ -96,67 +110,177 @@ void logCameraState(const Camera& camera) {
 
 // toggles
 bool showGui = true;
+int debugView = 0; // 0 = lit, 1 = normals, 2 = AO only
 bool enableSSAO = true;
 bool enableHBAO = false;
 bool enableALCHAO = false;
 bool enableTextures = true;
+bool enableFrustumCulling = true; // meshes whose bounds miss the view frustum are not submitted
+bool showSurfaceQueries = false; // GUI readout of the surfaces around the camera, its BVH queries and builds cost CPU time
+bool enableDepthPrepass = false; // depth is laid down first, the G-buffer pass then shades only the visible fragments
+bool enableFrontToBack = false; // visible meshes are drawn nearest first within each material batch
+bool enableDeinterleaving = false; // full resolution AO runs as 16 deinterleaved quarter resolution layers
+bool enableTemporalAO = false; // fewer AO samples per frame, accumulated over frames with reprojection
+bool enableComputeAO = false; // AO runs as compute dispatches over shared-memory G-buffer tiles
+bool fuseComputeBlur = false; // compute AO also blurs in the same dispatch instead of the blur passes
 
+// entry points past GL 3.3, computeShaders says whether the compute AO path can be used
+GLExtensions glExtensions;
 
-// logging of FPS test
-bool isTesting = false;
-int currentAOSetting = 0; // 0 = SSAO, 1 = HBAO, 2 = ALCHAO 3 = No AO
-float testDuration = 5.0f; // Test each AO for 5 seconds
-float elapsedTime = 0.0f; // Timer to keep track of elapsed time per setting
 
-int frameCount = 0; // Count number of frames in 5 seconds
-float fpsSum = 0.0f; // Sum the frames to be averaged later
+// AO settings walked by the benchmark, indexed by currentAOSetting
+int currentAOSetting = 0; // 0 = SSAO, 1 = HBAO, 2 = ALCHAO 3 = No AO, 4-6 = compute SSAO, HBAO, ALCHAO
+const std::vector<std::string> aoSettingNames = { "SSAO", "HBAO", "ALCHAO", "None", "SSAO Compute", "HBAO Compute", "ALCHAO Compute" };
+const int FRAGMENT_AO_SETTINGS = 4; // settings that don't need compute shaders
 
 // function to switch between AOs
 void applyAOSetting(int setting) {
-    enableSSAO = (setting == 0);
-    enableHBAO = (setting == 1);
-    enableALCHAO = (setting == 2);
-    if (setting == 3) {
-        enableSSAO = false;
-        enableHBAO = false;
-        enableALCHAO = false;
-    }
+    currentAOSetting = setting;
+    int technique = setting >= FRAGMENT_AO_SETTINGS ? setting - FRAGMENT_AO_SETTINGS : setting;
+    enableSSAO = (technique == 0);
+    enableHBAO = (technique == 1);
+    enableALCHAO = (technique == 2);
+    enableComputeAO = setting >= FRAGMENT_AO_SETTINGS;
+}
+
+// command line options
+struct AppOptions {
+    bool benchmark = false; // run the benchmark on startup and exit once the report is written
+    bool headless = false;  // invisible window on an OSMesa context, no GUI or input
+    int benchmarkFrames = 300;
+    int benchmarkWarmup = 30; // at least 1, the first frame of a case also pays for its shader switch and the load
+    std::string benchmarkOutput = "benchmark.json";
+    std::string modelPath = "C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/crytek_sponza/sponza.obj";
+    bool meshCache = true; // keep the model's import in a binary cache next to it and load from there
+    bool cookedTextures = true; // load block-compressed <image>.ktx files next to the model's images when up to date
+    bool cookTextures = false; // cook every model image without an up to date .ktx while loading it
+    bool reconstructPosition = false; // rebuild view-space position from a depth texture instead of storing gPosition
+    NormalEncoding normalEncoding = NORMAL_RGBA16F;
+    bool depthPyramid = false; // AO taps read a linear depth mip chain picked by tap distance
+    int aoResolution = 0; // initial AO resolution of every technique, 0 = full, 1 = half, 2 = quarter
+    bool deinterleave = false; // start with deinterleaved AO enabled
+    bool temporal = false; // start with temporal AO accumulation enabled
+    bool compute = false; // start with the compute AO path, if the context supports it
+    bool fusedBlur = false; // start with the blur fused into the compute AO dispatch
+    bool depthPrepass = false; // start with the depth pre-pass, off by default so overdraw is measured without it
+    bool frontToBack = false; // start with meshes drawn nearest first, off by default like the pre-pass
+    bool shaderCache = true; // load and store linked program binaries in shaderCacheDirectory
+    std::string shaderCacheDirectory = "shader_cache";
+};
+AppOptions options;
+
+// Benchmark runs through each camera and measures frame times for each AO setting
+Benchmark benchmark;
+
+// prints the accepted command line arguments
+void printUsage() {
+    std::cout << "Usage: screenspaceao [--benchmark] [--headless] [--frames N] [--warmup N] [--output report.json|report.csv]\n"
+        << "                     [--model path] [--width W] [--height H] [--depth-position]\n"
+        << "                     [--normals rgba16f|oct16|oct8] [--depth-pyramid]\n"
+        << "                     [--ao-resolution full|half|quarter] [--deinterleave] [--temporal]\n"
+        << "                     [--compute] [--fused-blur] [--shader-cache dir] [--no-shader-cache]\n"
+        << "                     [--depth-prepass|--no-depth-prepass] [--front-to-back|--no-front-to-back] (both off by default)\n"
+        << "                     [--no-mesh-cache] [--cook-textures] [--no-cooked-textures]" << std::endl;
 }
 
-// Testing function runs through each camera and measures fps for each AO for 5 seconds
-void updateTesting(float deltaTime) {
-    if (!isTesting) return;
-
-    elapsedTime += deltaTime;
-    fpsSum += 1.0f / deltaTime;
-    frameCount++;
-
-    // Check if the current test duration has elapsed
-    if (elapsedTime >= testDuration) {
-        float avgFPS = fpsSum / frameCount;
-        std::cout << "Camera Preset " << currentPresetIndex << ", AO Setting " << currentAOSetting << ": " << avgFPS << std::endl;
-
-        // Reset timers and counters for the next test
-        elapsedTime = 0.0f;
-        fpsSum = 0.0f;
-        frameCount = 0;
-
-        // Move to the next AO setting
-        currentAOSetting++;
-        if (currentAOSetting > 3) {
-            currentAOSetting = 0;
-
-            if (currentPresetIndex >= cameraPresets.size()-1) {
-                isTesting = false;
-                std::cout << "All tests complete." << std::endl;
-                return;
+// parses the command line into options, returns false on unknown or incomplete arguments and on bad values
+bool parseCommandLine(int argc, char** argv, AppOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--benchmark")
+            options.benchmark = true;
+        else if (arg == "--headless")
+            options.headless = true;
+        else if (arg == "--frames" && hasValue)
+            options.benchmarkFrames = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--warmup" && hasValue)
+            options.benchmarkWarmup = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--output" && hasValue)
+            options.benchmarkOutput = argv[++i];
+        else if (arg == "--depth-position")
+            options.reconstructPosition = true;
+        else if (arg == "--normals" && hasValue) {
+            std::string encoding = argv[++i];
+            if (encoding == "oct16")
+                options.normalEncoding = NORMAL_OCT16;
+            else if (encoding == "oct8")
+                options.normalEncoding = NORMAL_OCT8;
+            else if (encoding == "rgba16f")
+                options.normalEncoding = NORMAL_RGBA16F;
+            else {
+                std::cout << "Unknown normal encoding: " << encoding << "\n";
+                printUsage();
+                return false;
             }
-            switchCameraPreset(camera);
         }
-
-        // Apply the current AO setting for the new preset or after resetting AO settings
-        applyAOSetting(currentAOSetting);
+        else if (arg == "--depth-pyramid")
+            options.depthPyramid = true;
+        else if (arg == "--deinterleave")
+            options.deinterleave = true;
+        else if (arg == "--temporal")
+            options.temporal = true;
+        else if (arg == "--compute")
+            options.compute = true;
+        else if (arg == "--fused-blur")
+            options.fusedBlur = true;
+        else if (arg == "--depth-prepass")
+            options.depthPrepass = true;
+        else if (arg == "--no-depth-prepass")
+            options.depthPrepass = false;
+        else if (arg == "--front-to-back")
+            options.frontToBack = true;
+        else if (arg == "--no-front-to-back")
+            options.frontToBack = false;
+        else if (arg == "--no-mesh-cache")
+            options.meshCache = false;
+        else if (arg == "--cook-textures")
+            options.cookTextures = true;
+        else if (arg == "--no-cooked-textures")
+            options.cookedTextures = false;
+        else if (arg == "--no-shader-cache")
+            options.shaderCache = false;
+        else if (arg == "--shader-cache" && hasValue)
+            options.shaderCacheDirectory = argv[++i];
+        else if (arg == "--ao-resolution" && hasValue) {
+            std::string resolution = argv[++i];
+            if (resolution == "full")
+                options.aoResolution = 0;
+            else if (resolution == "half")
+                options.aoResolution = 1;
+            else if (resolution == "quarter")
+                options.aoResolution = 2;
+            else {
+                std::cout << "Unknown AO resolution: " << resolution << "\n";
+                printUsage();
+                return false;
+            }
+        }
+        else if (arg == "--model" && hasValue)
+            options.modelPath = argv[++i];
+        else if (arg == "--width" && hasValue)
+            SCR_WIDTH = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--height" && hasValue)
+            SCR_HEIGHT = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::cout << "Unknown argument: " << arg << "\n";
+            printUsage();
+            return false;
+        }
     }
+    return true;
+}
+
+// starts a benchmark run from the first camera preset and AO setting,
+// the compute AO settings are only walked when the context supports them
+void startBenchmark(Camera& camera) {
+    benchmark.measuredFrames = options.benchmarkFrames;
+    benchmark.warmupFrames = options.benchmarkWarmup;
+    benchmark.outputPath = options.benchmarkOutput;
+    size_t settingCount = glExtensions.computeShaders ? aoSettingNames.size() : FRAGMENT_AO_SETTINGS;
+    benchmark.start((int)cameraPresets.size(), std::vector<std::string>(aoSettingNames.begin(), aoSettingNames.begin() + settingCount));
+    applyCameraPreset(camera, benchmark.currentPreset);
+    applyAOSetting(benchmark.currentAOSetting);
 }
 
 
@@ -170,22 +294,78 @@ float ourLerp(float a, float b, float f)
     return a + f * (b - a);
 }
 
+// AO buffer dimensions for a resolution setting (0 = full, 1 = half, 2 = quarter)
+unsigned int aoWidth(int resolution)
+{
+    return std::max(1u, SCR_WIDTH >> resolution);
+}
+unsigned int aoHeight(int resolution)
+{
+    return std::max(1u, SCR_HEIGHT >> resolution);
+}
 
+// size of one deinterleaved layer, every layer holds one pixel of each 4x4 block of the screen
+unsigned int layerWidth()
+{
+    return (SCR_WIDTH + 3) / 4;
+}
+unsigned int layerHeight()
+{
+    return (SCR_HEIGHT + 3) / 4;
+}
 
-int main()
+// reallocates a technique's AO and blur buffers for a resolution setting, their framebuffer attachments stay valid
+// (sized GL_R16F so the compute AO path can bind them as images)
+void resizeAOBuffers(unsigned int colorBuffer, unsigned int colorBufferBlur, int resolution)
 {
+    unsigned int buffers[2] = { colorBuffer, colorBufferBlur };
+    for (unsigned int buffer : buffers)
+    {
+        glBindTexture(GL_TEXTURE_2D, buffer);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, aoWidth(resolution), aoHeight(resolution), 0, GL_RED, GL_FLOAT, NULL);
+    }
+}
+
+
+
+int main(int argc, char** argv)
+{
+    if (!parseCommandLine(argc, argv, options))
+        return -1;
+
     // glfw: initialize and configure
+#ifdef GLFW_PLATFORM_NULL
+    // headless runs don't need a display server
+    if (options.headless)
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+#endif
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    // glfw window creation
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    // headless: invisible window on an offscreen OSMesa context (runs on Mesa llvmpipe without a GPU)
+    if (options.headless)
+    {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef GLFW_OSMESA_CONTEXT_API
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+#endif
+    }
+
+    // glfw window creation, GL 4.3 enables the compute AO path, everything else only needs 3.3
+    const int contextVersions[2][2] = { { 4, 3 }, { 3, 3 } };
+    GLFWwindow* window = NULL;
+    for (const auto& version : contextVersions)
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, version[0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, version[1]);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+        if (window != NULL)
+            break;
+    }
     if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
@@ -198,7 +378,8 @@ int main()
     glfwSetScrollCallback(window, scroll_callback);
 
     // tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    if (!options.headless)
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
     // uncap fps
     glfwSwapInterval(0);
@@ -210,71 +391,176 @@ int main()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    glExtensions.load((GLADloadproc)glfwGetProcAddress);
+    if (options.compute && !glExtensions.computeShaders)
+        std::cout << "Compute AO needs OpenGL 4.3, using the fragment path" << std::endl;
+    if (options.shaderCache)
+        programBinaryCache().enable(glExtensions, options.shaderCacheDirectory);
+    textureStreamer().enable(glExtensions, options.cookedTextures, options.cookTextures);
 
     // configure global opengl state
     glEnable(GL_DEPTH_TEST);
 
     // build and compile shaders
-
-    Shader shaderGeometryPass("ssao_geometry.vs", "ssao_geometry.fs");
-    Shader shaderLightingPass("ssao.vs", "ssao_lighting.fs");
-
-    Shader shaderSSAO("ssao.vs", "ssao.fs");
-    Shader shaderSSAOBlur("ssao.vs", "ssao_blur.fs");
-
-    Shader shaderHBAO("ssao.vs", "hbao.fs");
-    Shader shaderHBAOBlur("ssao.vs", "ssao_blur.fs");
-
-    Shader shaderALCHAO("ssao.vs", "ssao_alch.fs");
-    Shader shaderALCHAOBlur("ssao.vs", "ssao_blur.fs");
+    // G-buffer layout options shared by every shader reading the G-buffer
+    std::vector<std::string> gBufferDefines;
+    if (options.reconstructPosition)
+        gBufferDefines.push_back("RECONSTRUCT_POSITION");
+    if (options.normalEncoding != NORMAL_RGBA16F)
+        gBufferDefines.push_back("OCTAHEDRAL_NORMALS");
+
+    // programs are built on first use, or all issued here when the driver compiles in parallel
+    ShaderRegistry shaders;
+    shaders.enableParallelCompile(glExtensions);
+
+    // the geometry pass runs every frame and its uniform handles need the linked program
+    Shader& shaderGeometryPass = shaders.get("ssao_geometry.vs", "ssao_geometry.fs", gBufferDefines);
+    shaderGeometryPass.build();
+    UniformHandle<bool> geometryUseTexture = shaderGeometryPass.uniform<bool>("useTexture");
+    UniformHandle<glm::mat4> geometryModel = shaderGeometryPass.uniform<glm::mat4>("model");
+    Shader& shaderDepthPrepass = shaders.get("depth_prepass.vs", "depth_prepass.fs");
+    shaderDepthPrepass.build();
+    UniformHandle<glm::mat4> depthPrepassModel = shaderDepthPrepass.uniform<glm::mat4>("model");
+    Shader& shaderLightingPass = shaders.get("ssao.vs", "ssao_lighting.fs", gBufferDefines);
+
+    // AO passes additionally choose where their taps read depth from
+    std::vector<std::string> aoDefines = gBufferDefines;
+    if (options.depthPyramid)
+        aoDefines.push_back("DEPTH_PYRAMID");
+
+    // each AO program is specialized on its loop counts (KERNEL_SIZE, NUM_DIRECTIONS, NUM_STEPS, K),
+    // the variant matching the current sliders is picked every frame
+    const std::vector<std::string> ssaoParameters = { "KERNEL_SIZE" };
+    const std::vector<std::string> hbaoParameters = { "NUM_DIRECTIONS", "NUM_STEPS" };
+    const std::vector<std::string> alchaoParameters = { "KERNEL_SIZE", "K" };
+    ShaderPermutations shaderSSAO(shaders, "ssao.vs", "ssao.fs", aoDefines, ssaoParameters);
+    ShaderPermutations shaderHBAO(shaders, "ssao.vs", "hbao.fs", aoDefines, hbaoParameters);
+    ShaderPermutations shaderALCHAO(shaders, "ssao.vs", "ssao_alch.fs", aoDefines, alchaoParameters);
+    // every technique blurs with the same program, all of its uniforms are set per pass
+    Shader& shaderAOBlur = shaders.get("ssao.vs", "ssao_blur.fs", gBufferDefines);
+
+    Shader& shaderAOUpsample = shaders.get("ssao.vs", "ao_upsample.fs", gBufferDefines);
+
+    // deinterleaved variants of the AO passes, they shade one quarter resolution layer per draw
+    std::vector<std::string> deinterleavedDefines = aoDefines;
+    deinterleavedDefines.push_back("DEINTERLEAVED");
+    ShaderPermutations shaderSSAODeinterleaved(shaders, "ssao.vs", "ssao.fs", deinterleavedDefines, ssaoParameters);
+    ShaderPermutations shaderHBAODeinterleaved(shaders, "ssao.vs", "hbao.fs", deinterleavedDefines, hbaoParameters);
+    ShaderPermutations shaderALCHAODeinterleaved(shaders, "ssao.vs", "ssao_alch.fs", deinterleavedDefines, alchaoParameters);
+    Shader& shaderDeinterleave = shaders.get("ssao.vs", "ao_deinterleave.fs", gBufferDefines);
+    Shader& shaderReinterleave = shaders.get("ssao.vs", "ao_reinterleave.fs");
+    Shader& shaderAOTemporal = shaders.get("ssao.vs", "ao_temporal.fs", gBufferDefines);
+
+    Shader& shaderDepthLinearize = shaders.get("ssao.vs", "depth_linearize.fs", gBufferDefines);
+    Shader& shaderDepthDownsample = shaders.get("ssao.vs", "depth_downsample.fs");
+
+    // compute variants of the AO passes, only ever requested when the context supports them
+    ShaderPermutations shaderSSAOCompute(shaders, "ssao.comp", aoDefines, ssaoParameters);
+    ShaderPermutations shaderHBAOCompute(shaders, "hbao.comp", aoDefines, hbaoParameters);
+    ShaderPermutations shaderALCHAOCompute(shaders, "ssao_alch.comp", aoDefines, alchaoParameters);
 
     // load models
-    string modelPath = "C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/crytek_sponza/sponza.obj";
-    Model sponzaModel(modelPath);
+    Model sponzaModel(options.modelPath, false, options.meshCache);
+    sponzaModel.enableMultiDrawIndirect(glExtensions);
+    std::cout << "Model: " << sponzaModel.meshes.size() << " meshes drawn with " << sponzaModel.drawCallCount() << " draw calls"
+        << (glExtensions.multiDrawIndirect ? " (multi-draw-indirect)" : "") << std::endl;
 
 
     // configure g-buffer framebuffer
     unsigned int gBuffer;
     glGenFramebuffers(1, &gBuffer);
     glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-    unsigned int gPosition, gNormal, gAlbedo;
-    // position color buffer
-    glGenTextures(1, &gPosition);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-    // normal color buffer
+    unsigned int gPosition = 0, gNormal, gAlbedo, gDepth = 0;
+    unsigned int colorAttachment = 0;
+    // position color buffer, not needed when the position is reconstructed from depth
+    if (!options.reconstructPosition)
+    {
+        glGenTextures(1, &gPosition);
+        glBindTexture(GL_TEXTURE_2D, gPosition);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + colorAttachment++, GL_TEXTURE_2D, gPosition, 0);
+    }
+    // normal color buffer, full half-float vector or two channel octahedral encoding
+    NormalEncodingFormat normalFormat = getNormalEncodingFormat(options.normalEncoding);
     glGenTextures(1, &gNormal);
     glBindTexture(GL_TEXTURE_2D, gNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, normalFormat.internalFormat, SCR_WIDTH, SCR_HEIGHT, 0, normalFormat.format, normalFormat.type, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + colorAttachment++, GL_TEXTURE_2D, gNormal, 0);
     // color + specular color buffer
     glGenTextures(1, &gAlbedo);
     glBindTexture(GL_TEXTURE_2D, gAlbedo);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedo, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + colorAttachment++, GL_TEXTURE_2D, gAlbedo, 0);
     // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering 
     unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-    glDrawBuffers(3, attachments);
-    // create and attach depth buffer (renderbuffer)
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
+    glDrawBuffers(colorAttachment, attachments);
+    if (options.reconstructPosition)
+    {
+        // sampleable 32-bit float depth texture, the AO and lighting passes rebuild the position from it
+        glGenTextures(1, &gDepth);
+        glBindTexture(GL_TEXTURE_2D, gDepth);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, SCR_WIDTH, SCR_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, gDepth, 0);
+    }
+    else
+    {
+        // create and attach depth buffer (renderbuffer)
+        unsigned int rboDepth;
+        glGenRenderbuffers(1, &rboDepth);
+        glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
+    }
+    // compare the round-trip precision of every normal encoding against the one in use
+    NormalEncodingError normalErrors[3];
+    for (int i = 0; i < 3; i++)
+    {
+        normalErrors[i] = measureNormalEncodingError((NormalEncoding)i);
+        std::cout << "Normal encoding " << getNormalEncodingFormat((NormalEncoding)i).name
+            << ": mean error " << normalErrors[i].meanDegrees << " deg, max error " << normalErrors[i].maxDegrees << " deg"
+            << (i == options.normalEncoding ? " (in use)" : "") << std::endl;
+    }
+
+    // texture the AO and lighting passes read the view-space position from (bound to unit 0)
+    unsigned int gViewPosition = options.reconstructPosition ? gDepth : gPosition;
     // finally check if framebuffer is complete
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "Framebuffer not complete!" << std::endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    // DEPTH PYRAMID------------------------------------------------------------------------------
+    // linear depth mip chain built after the geometry pass, sampled by the AO taps
+    const int DEPTH_PYRAMID_LEVELS = 6; // matches MAX_MIP_LEVEL in gbuffer.glsl
+    unsigned int depthPyramidFBO, depthPyramid;
+    glGenFramebuffers(1, &depthPyramidFBO);
+    glGenTextures(1, &depthPyramid);
+    glBindTexture(GL_TEXTURE_2D, depthPyramid);
+    for (int level = 0; level < DEPTH_PYRAMID_LEVELS; level++)
+        glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, std::max(1u, SCR_WIDTH >> level), std::max(1u, SCR_HEIGHT >> level), 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, DEPTH_PYRAMID_LEVELS - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindFramebuffer(GL_FRAMEBUFFER, depthPyramidFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, depthPyramid, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Depth Pyramid Framebuffer not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
     // SSAO-------------------------------------------------------------------------------------
     // create framebuffer to hold SSAO processing stage 
     unsigned int ssaoFBO, ssaoBlurFBO;
@@ -284,7 +570,7 @@ int main()
     // SSAO color buffer
     glGenTextures(1, &ssaoColorBuffer);
     glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBuffer, 0);
@@ -294,7 +580,7 @@ int main()
     glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
     glGenTextures(1, &ssaoColorBufferBlur);
     glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBufferBlur, 0);
@@ -312,7 +598,7 @@ int main()
     // HBAO color buffer
     glGenTextures(1, &hbaoColorBuffer);
     glBindTexture(GL_TEXTURE_2D, hbaoColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, hbaoColorBuffer, 0);
@@ -322,7 +608,7 @@ int main()
     glBindFramebuffer(GL_FRAMEBUFFER, hbaoBlurFBO);
     glGenTextures(1, &hbaoColorBufferBlur);
     glBindTexture(GL_TEXTURE_2D, hbaoColorBufferBlur);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, hbaoColorBufferBlur, 0);
@@ -340,7 +626,7 @@ int main()
     // ALCHAO color buffer
     glGenTextures(1, &alchaoColorBuffer);
     glBindTexture(GL_TEXTURE_2D, alchaoColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, alchaoColorBuffer, 0);
@@ -350,7 +636,7 @@ int main()
     glBindFramebuffer(GL_FRAMEBUFFER, alchaoBlurFBO);
     glGenTextures(1, &alchaoColorBufferBlur);
     glBindTexture(GL_TEXTURE_2D, alchaoColorBufferBlur);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, alchaoColorBufferBlur, 0);
@@ -358,6 +644,79 @@ int main()
         std::cout << "ALCHAO Blur Framebuffer not complete!" << std::endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    // AO UPSAMPLE------------------------------------------------------------------------------
+    // full resolution AO for techniques running at half or quarter resolution
+    unsigned int aoUpsampleFBO, aoUpsampleBuffer;
+    glGenFramebuffers(1, &aoUpsampleFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, aoUpsampleFBO);
+    glGenTextures(1, &aoUpsampleBuffer);
+    glBindTexture(GL_TEXTURE_2D, aoUpsampleBuffer);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, aoUpsampleBuffer, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "AO Upsample Framebuffer not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // DEINTERLEAVED AO----------------------------------------------------------------------------
+    // linear depth and normals split into 16 quarter resolution layers, and the AO computed per layer
+    const int DEINTERLEAVED_LAYERS = 16;
+    unsigned int deinterleaveFBO, aoLayersFBO;
+    glGenFramebuffers(1, &deinterleaveFBO);
+    glGenFramebuffers(1, &aoLayersFBO);
+    unsigned int deinterleavedDepth, deinterleavedNormal, aoLayers;
+    glGenTextures(1, &deinterleavedDepth);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, deinterleavedDepth);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, layerWidth(), layerHeight(), DEINTERLEAVED_LAYERS, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glGenTextures(1, &deinterleavedNormal);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, deinterleavedNormal);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA16F, layerWidth(), layerHeight(), DEINTERLEAVED_LAYERS, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glGenTextures(1, &aoLayers);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, aoLayers);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R16F, layerWidth(), layerHeight(), DEINTERLEAVED_LAYERS, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // attach the first layers to check completeness, each pass re-attaches the layer it writes
+    glBindFramebuffer(GL_FRAMEBUFFER, deinterleaveFBO);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, deinterleavedDepth, 0, 0);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, deinterleavedNormal, 0, 0);
+    glDrawBuffers(2, attachments);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Deinterleave Framebuffer not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, aoLayersFBO);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, aoLayers, 0, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "AO Layers Framebuffer not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // the layer quad covers 4 * layer size G-buffer pixels, which overhangs the screen when it isn't a multiple of 4
+    glm::vec2 layerTexCoordScale(4.0f * layerWidth() / SCR_WIDTH, 4.0f * layerHeight() / SCR_HEIGHT);
+
+    // TEMPORAL AO-------------------------------------------------------------------------------
+    // ping-pong history of the accumulated AO, each frame reads one and writes the other
+    unsigned int temporalFBO[2], temporalHistory[2];
+    glGenFramebuffers(2, temporalFBO);
+    glGenTextures(2, temporalHistory);
+    for (int i = 0; i < 2; i++)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, temporalFBO[i]);
+        glBindTexture(GL_TEXTURE_2D, temporalHistory[i]);
+        // AO, history length and linear depth for the disocclusion test
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, temporalHistory[i], 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Temporal AO Framebuffer not complete!" << std::endl;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
 
     // generate ssao sample kernel
     std::uniform_real_distribution<GLfloat> randomFloats(0.0, 1.0); // generates random floats between 0.0 and 1.0
@@ -417,7 +776,7 @@ int main()
 
     // lighting info
     // -------------
-    const unsigned int NR_LIGHTS = 14;
+    const unsigned int NR_LIGHTS = MAX_LIGHTS;
     std::vector<glm::vec3> lightColors = {
         glm::vec3(1.0f, 1.0f, 1.0f), 
         glm::vec3(1.0f, 1.0f, 1.0f), 
@@ -452,41 +811,101 @@ int main()
         glm::vec3(0.0f, 40.0f, 0.0f)
     };
 
-    // shader configuration
+    // uniform buffers shared by every program, the camera constants are updated each frame
+    // and the lights and AO kernel only when they change
     // --------------------
-    shaderLightingPass.use();
-    shaderLightingPass.setInt("gPosition", 0);
-    shaderLightingPass.setInt("gNormal", 1);
-    shaderLightingPass.setInt("gAlbedo", 2);
-    shaderLightingPass.setVec3("viewPos", camera.Position);
-    shaderLightingPass.setInt("ssao", 3);
-    shaderLightingPass.setVec3("dirLight.Direction", -0.2f, -1.0f, -0.3f);
-    shaderLightingPass.setVec3("dirLight.Color", 0.5f, 0.5f, 0.5f); 
-    shaderSSAO.use();
-    shaderSSAO.setInt("gPosition", 0);
-    shaderSSAO.setInt("gNormal", 1);
-    shaderSSAO.setInt("texNoise", 2);
-    shaderSSAOBlur.use();
-    shaderSSAOBlur.setInt("ssaoInput", 0);
-    shaderHBAO.use();
-    shaderHBAO.setInt("gPosition", 0);
-    shaderHBAO.setInt("gNormal", 1);
-    shaderHBAO.setInt("texNoise", 2);
-    shaderHBAOBlur.use();
-    shaderHBAOBlur.setInt("hbaoInput", 0);
-    shaderALCHAO.use();
-    shaderALCHAO.setInt("gPosition", 0);
-    shaderALCHAO.setInt("gNormal", 1);
-    shaderALCHAO.setInt("texNoise", 2);
-    shaderALCHAOBlur.use();
-    shaderALCHAOBlur.setInt("ssaoInput", 0);
+    UniformBuffer<FrameUniforms> frameUniformBuffer(FRAME_UNIFORMS_BINDING);
+    UniformBuffer<LightUniforms> lightUniformBuffer(LIGHT_UNIFORMS_BINDING);
+    UniformBuffer<KernelUniforms> kernelUniformBuffer(KERNEL_UNIFORMS_BINDING);
+
+    LightUniforms lightUniforms = {};
+    lightUniforms.dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+    lightUniforms.dirLight.color = glm::vec3(0.5f, 0.5f, 0.5f);
+    for (unsigned int i = 0; i < NR_LIGHTS; ++i) {
+        lightUniforms.lights[i].position = lightPositions[i];
+        lightUniforms.lights[i].color = lightColors[i];
+        lightUniforms.lights[i].linear = 0.09f;    // Assuming all lights have the same
+        lightUniforms.lights[i].quadratic = 0.01f; // attenuation factors.
+    }
+    lightUniformBuffer.update(lightUniforms);
+
+    KernelUniforms kernelUniforms = {};
+    for (unsigned int i = 0; i < 16; ++i)
+        kernelUniforms.samples[i] = glm::vec4(ssaoKernel[i], 0.0f);
+    kernelUniformBuffer.update(kernelUniforms);
+
+    // shader configuration, sampler units are applied whenever each program gets linked
+    // --------------------
+    shaderLightingPass.setSampler("gPosition", 0);
+    shaderLightingPass.setSampler("gDepth", 0);
+    shaderLightingPass.setSampler("gNormal", 1);
+    shaderLightingPass.setSampler("gAlbedo", 2);
+    shaderLightingPass.setSampler("ssao", 3);
+    shaderSSAO.setSampler("gPosition", 0);
+    shaderSSAO.setSampler("gDepth", 0);
+    shaderSSAO.setSampler("gNormal", 1);
+    shaderSSAO.setSampler("texNoise", 2);
+    shaderSSAO.setSampler("depthPyramid", 3);
+    shaderAOBlur.setSampler("ssaoInput", 0);
+    shaderAOBlur.setSampler("gPosition", 1);
+    shaderAOBlur.setSampler("gDepth", 1);
+    shaderAOBlur.setSampler("gNormal", 2);
+    shaderHBAO.setSampler("gPosition", 0);
+    shaderHBAO.setSampler("gDepth", 0);
+    shaderHBAO.setSampler("gNormal", 1);
+    shaderHBAO.setSampler("texNoise", 2);
+    shaderHBAO.setSampler("depthPyramid", 3);
+    shaderALCHAO.setSampler("gPosition", 0);
+    shaderALCHAO.setSampler("gDepth", 0);
+    shaderALCHAO.setSampler("gNormal", 1);
+    shaderALCHAO.setSampler("texNoise", 2);
+    shaderALCHAO.setSampler("depthPyramid", 3);
+    shaderAOUpsample.setSampler("gPosition", 0);
+    shaderAOUpsample.setSampler("gDepth", 0);
+    shaderAOUpsample.setSampler("gNormal", 1);
+    shaderAOUpsample.setSampler("aoInput", 2);
+    ShaderPermutations* deinterleavedAOShaders[3] = { &shaderSSAODeinterleaved, &shaderHBAODeinterleaved, &shaderALCHAODeinterleaved };
+    for (ShaderPermutations* shader : deinterleavedAOShaders)
+    {
+        shader->setSampler("gPosition", 0);
+        shader->setSampler("gDepth", 0);
+        shader->setSampler("gNormal", 1);
+        shader->setSampler("texNoise", 2);
+        shader->setSampler("deinterleavedDepth", 4);
+        shader->setSampler("deinterleavedNormal", 5);
+    }
+    shaderDeinterleave.setSampler("gPosition", 0);
+    shaderDeinterleave.setSampler("gDepth", 0);
+    shaderDeinterleave.setSampler("gNormal", 1);
+    shaderReinterleave.setSampler("aoLayers", 0);
+    shaderAOTemporal.setSampler("gPosition", 0);
+    shaderAOTemporal.setSampler("gDepth", 0);
+    shaderAOTemporal.setSampler("aoInput", 2);
+    shaderAOTemporal.setSampler("aoHistory", 3);
+    shaderDepthLinearize.setSampler("gPosition", 0);
+    shaderDepthLinearize.setSampler("gDepth", 0);
+    shaderDepthDownsample.setSampler("depthInput", 0);
+    ShaderPermutations* computeAOShaders[3] = { &shaderSSAOCompute, &shaderHBAOCompute, &shaderALCHAOCompute };
+    for (ShaderPermutations* shader : computeAOShaders)
+    {
+        shader->setSampler("gPosition", 0);
+        shader->setSampler("gDepth", 0);
+        shader->setSampler("gNormal", 1);
+        shader->setSampler("texNoise", 2);
+        shader->setSampler("depthPyramid", 3);
+    }
 
 
     // initialize imgui
-    IMGUI_CHECKVERSION();
-    ImGui::CreateContext();
-    ImGui_ImplGlfw_InitForOpenGL(window, true);
-    ImGui_ImplOpenGL3_Init("#version 330");
+    if (options.headless)
+        showGui = false;
+    else
+    {
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGui_ImplGlfw_InitForOpenGL(window, true);
+        ImGui_ImplOpenGL3_Init("#version 330");
+    }
     
     // white texture
     GLuint whiteTexture;
@@ -497,6 +916,25 @@ int main()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
+    // AO resolution per technique (0 = full, 1 = half, 2 = quarter) and the resolution its buffers currently have
+    int ss_resolution = options.aoResolution, ss_allocatedResolution = 0;
+    int hb_resolution = options.aoResolution, hb_allocatedResolution = 0;
+    int al_resolution = options.aoResolution, al_allocatedResolution = 0;
+    enableDeinterleaving = options.deinterleave;
+    enableTemporalAO = options.temporal;
+    enableComputeAO = options.compute && glExtensions.computeShaders;
+    fuseComputeBlur = options.fusedBlur;
+    enableDepthPrepass = options.depthPrepass;
+    enableFrontToBack = options.frontToBack;
+
+    // Temporal AO Parameters
+    const int TEMPORAL_SAMPLES = 4; // AO samples per pixel per frame, the kernel's 16 are covered every 4 frames
+    float temporalBlend = 0.1f;
+    unsigned int temporalFrame = 0;
+    int temporalCurrent = 0;
+    int temporalTechnique = -1; // technique the history was accumulated from, -1 = no history
+    glm::mat4 prevView(1.0f), prevProjection(1.0f);
+
     // SSAO Parameters
     int ss_kernelSize = 16;
     float ss_radius = 2.9f;
@@ -505,6 +943,7 @@ int main()
     // HBAO Parameters
     float hb_radius = 500000.f;
     float hb_bias = 0.f;
+    int hb_directions = 4;
     int hb_samples = 4;
 
     // ALCHAO Parameters
@@ -516,10 +955,33 @@ int main()
     float al_beta = 0.001f;
     float al_turns = 10.0f;
 
+    // AO Blur Parameters, shared by all techniques apart from the radius
+    int ss_blurRadius = 4;
+    int hb_blurRadius = 4;
+    int al_blurRadius = 8;
+    float blurDepthSharpness = 16.0f;
+    bool blurNormals = false;
+
+    // Compute AO Parameters
+    const int COMPUTE_TILE_SIZE = 16; // workgroup block size, matches TILE_SIZE in gbuffer.glsl
+    const int COMPUTE_BLUR_APRON = 4; // widest fused blur radius, matches BLUR_APRON in gbuffer.glsl
+
     // Initialize camera presets
     initializeCameraPresets();
 
+    // benchmark report metadata
+    benchmark.renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+    benchmark.width = SCR_WIDTH;
+    benchmark.height = SCR_HEIGHT;
+    if (options.benchmark)
+        startBenchmark(camera);
+    int exitCode = 0;
+
+    // per-pass GPU timings for the GUI and the benchmark report
+    GpuProfiler profiler;
+
     // render loop
+    bool firstFrame = true;
     while (!glfwWindowShouldClose(window))
     {
         // per-frame time logic
@@ -530,188 +992,461 @@ int main()
         // input
         processInput(window);
 
-        updateTesting(deltaTime); // Update AO testing status
+        // link the programs whose background compile finished, a benchmark builds the rest up front
+        // so none lands inside a measured frame
+        if (shaders.poll())
+            std::cout << "All " << shaders.programCount() << " shader programs linked after " << glfwGetTime() << " s" << std::endl;
+        if (benchmark.running && shaders.linkedCount() < shaders.programCount())
+            shaders.buildAll();
+
+        // upload the textures decoded since the last frame, a benchmark waits for all of them
+        bool texturesPending = textureStreamer().pending() > 0;
+        if (benchmark.running)
+            textureStreamer().finish();
+        else
+            textureStreamer().update();
+        if (texturesPending && textureStreamer().pending() == 0)
+        {
+            std::cout << "All " << textureStreamer().requestedCount() << " textures streamed in after " << glfwGetTime() << " s" << std::endl;
+            std::cout << textureStreamer().summary() << std::endl;
+        }
+
+        // Update benchmark status, applying the next preset/AO setting when a case completes
+        if (benchmark.update(deltaTime, &profiler))
+        {
+            if (benchmark.running)
+            {
+                applyCameraPreset(camera, benchmark.currentPreset);
+                applyAOSetting(benchmark.currentAOSetting);
+            }
+            else
+            {
+                if (!benchmark.writeReport())
+                    exitCode = 1;
+                if (options.benchmark)
+                    glfwSetWindowShouldClose(window, true);
+            }
+        }
+
+        profiler.beginFrame();
+        glState().beginFrame();
 
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // geometry pass
+        profiler.beginPass("Geometry");
         glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
             glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
             glm::mat4 view = camera.GetViewMatrix();
+            glm::mat4 invProjection = glm::inverse(projection);
+            FrameUniforms frameUniforms = {};
+            frameUniforms.view = view;
+            frameUniforms.projection = projection;
+            frameUniforms.invView = glm::inverse(view);
+            frameUniforms.invProjection = invProjection;
+            frameUniforms.viewPos = camera.Position;
+            frameUniformBuffer.update(frameUniforms);
             glm::mat4 model = glm::mat4(1.0f);
-            shaderGeometryPass.use();  // Use the arrow operator to access methods
-            shaderGeometryPass.setBool("useTexture", enableTextures);
-            shaderGeometryPass.setMat4("projection", projection);
-            shaderGeometryPass.setMat4("view", view);
-            
-            model = glm::mat4(1.0f);
             model = glm::translate(model, glm::vec3(0.0f, 0.5f, 0.0));
             model = glm::scale(model, glm::vec3(0.1f));
-            shaderGeometryPass.setMat4("model", model);
 
+            sponzaModel.setDrawOrder(enableFrontToBack, glm::vec3(glm::inverse(model) * glm::vec4(camera.Position, 1.0f)));
+            if (enableFrustumCulling)
+                sponzaModel.cull(projection * view * model);
+            else
+                sponzaModel.cullNone();
+
+            // depth only, then the G-buffer targets are written once per pixel for the fragments that matched it
+            if (enableDepthPrepass)
+            {
+                profiler.beginPass("Depth Pre-pass");
+                profiler.beginSampleCount("Depth Pre-pass");
+                shaderDepthPrepass.use();
+                depthPrepassModel.set(model);
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                sponzaModel.DrawDepth();
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                profiler.endSampleCount();
+                profiler.endPass();
+                glDepthFunc(GL_EQUAL);
+                glDepthMask(GL_FALSE);
+            }
+
+            shaderGeometryPass.use();  // Use the arrow operator to access methods
+            geometryUseTexture.set(enableTextures);
+            geometryModel.set(model);
+            profiler.beginSampleCount("Geometry");
             sponzaModel.Draw(shaderGeometryPass);
+            profiler.endSampleCount();
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        profiler.endPass();
+
+        // DEPTH PYRAMID--------------------------------------------------------------------------
+        // linearize depth into level 0, then build each level from the one above it
+        if (options.depthPyramid && (enableSSAO || enableHBAO || enableALCHAO)) {
+            profiler.beginPass("Depth Pyramid");
+            glBindFramebuffer(GL_FRAMEBUFFER, depthPyramidFBO);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, depthPyramid, 0);
+            shaderDepthLinearize.use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, gViewPosition);
+            renderQuad();
+
+            shaderDepthDownsample.use();
+            glBindTexture(GL_TEXTURE_2D, depthPyramid);
+            for (int level = 1; level < DEPTH_PYRAMID_LEVELS; level++) {
+                // only the previous level is readable while this one is the render target
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, depthPyramid, level);
+                glViewport(0, 0, std::max(1u, SCR_WIDTH >> level), std::max(1u, SCR_HEIGHT >> level));
+                renderQuad();
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, DEPTH_PYRAMID_LEVELS - 1);
+            glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            profiler.endPass();
+        }
+
+        // reallocate AO buffers of techniques whose resolution was changed
+        if (ss_resolution != ss_allocatedResolution) {
+            resizeAOBuffers(ssaoColorBuffer, ssaoColorBufferBlur, ss_resolution);
+            ss_allocatedResolution = ss_resolution;
+        }
+        if (hb_resolution != hb_allocatedResolution) {
+            resizeAOBuffers(hbaoColorBuffer, hbaoColorBufferBlur, hb_resolution);
+            hb_allocatedResolution = hb_resolution;
+        }
+        if (al_resolution != al_allocatedResolution) {
+            resizeAOBuffers(alchaoColorBuffer, alchaoColorBufferBlur, al_resolution);
+            al_allocatedResolution = al_resolution;
+        }
+
+        // brings reduced resolution AO back to full resolution with a depth and normal aware bilateral upsample,
+        // returns the texture the lighting pass should read
+        auto upsampleAO = [&](unsigned int aoBuffer, int resolution) -> unsigned int {
+            if (resolution == 0)
+                return aoBuffer;
+            profiler.beginPass("AO Upsample");
+            glBindFramebuffer(GL_FRAMEBUFFER, aoUpsampleFBO);
+            shaderAOUpsample.use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, gViewPosition);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, gNormal);
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, aoBuffer);
+            renderQuad();
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            profiler.endPass();
+            return aoUpsampleBuffer;
+        };
+
+        // separable bilateral blur of a technique's AO: horizontally from colorBuffer into blurBuffer,
+        // then vertically back into colorBuffer, which ends up holding the result
+        auto blurAO = [&](Shader& blurShader, unsigned int fbo, unsigned int colorBuffer, unsigned int blurFBO, unsigned int blurBuffer, int radius) {
+            blurShader.use();
+            blurShader.setInt("blurRadius", radius);
+            blurShader.setFloat("depthSharpness", blurDepthSharpness);
+            blurShader.setBool("useNormals", blurNormals);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, gViewPosition);
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, gNormal);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, blurFBO);
+            blurShader.setVec2("direction", 1.0f, 0.0f);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, colorBuffer);
+            renderQuad();
+
+            glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+            blurShader.setVec2("direction", 0.0f, 1.0f);
+            glBindTexture(GL_TEXTURE_2D, blurBuffer);
+            renderQuad();
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        };
+        unsigned int aoResult = whiteTexture;
+        int aoTechnique = -1; // 0 = SSAO, 1 = HBAO, 2 = ALCHAO, whichever wrote aoResult
+
+        // temporal AO rotates the noise by the golden angle and takes every fourth kernel sample, starting one further each frame
+        float temporalRotation = enableTemporalAO ? std::fmod(temporalFrame * 2.39996323f, 6.28318531f) : 0.0f;
+        int temporalSampleStride = enableTemporalAO ? 16 / TEMPORAL_SAMPLES : 1;
+        int temporalFrameSlot = enableTemporalAO ? (int)(temporalFrame % (16 / TEMPORAL_SAMPLES)) : 0;
+
+        // DEINTERLEAVE---------------------------------------------------------------------------
+        // techniques at full resolution shade the 16 deinterleaved layers instead of the whole screen when enabled
+        // (the compute path gets its cache locality from shared-memory tiles instead)
+        auto deinterleaved = [&](int resolution) { return enableDeinterleaving && !enableComputeAO && resolution == 0; };
+        if ((enableSSAO && deinterleaved(ss_resolution)) || (enableHBAO && deinterleaved(hb_resolution)) || (enableALCHAO && deinterleaved(al_resolution))) {
+            profiler.beginPass("AO Deinterleave");
+            glViewport(0, 0, layerWidth(), layerHeight());
+            glBindFramebuffer(GL_FRAMEBUFFER, deinterleaveFBO);
+            shaderDeinterleave.use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, gViewPosition);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, gNormal);
+            for (int layer = 0; layer < DEINTERLEAVED_LAYERS; layer++) {
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, deinterleavedDepth, 0, layer);
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, deinterleavedNormal, 0, layer);
+                shaderDeinterleave.setInt("deinterleaveLayer", layer);
+                renderQuad();
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+            profiler.endPass();
+        }
+
+        // draws an AO shader the caller has already set up once per deinterleaved layer,
+        // then gathers the layers back into the full resolution target of targetFBO
+        auto renderDeinterleavedAO = [&](Shader& shader, unsigned int targetFBO) {
+            glActiveTexture(GL_TEXTURE4);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, deinterleavedDepth);
+            glActiveTexture(GL_TEXTURE5);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, deinterleavedNormal);
+            glViewport(0, 0, layerWidth(), layerHeight());
+            glBindFramebuffer(GL_FRAMEBUFFER, aoLayersFBO);
+            for (int layer = 0; layer < DEINTERLEAVED_LAYERS; layer++) {
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, aoLayers, 0, layer);
+                shader.setInt("deinterleaveLayer", layer);
+                shader.setVec4("texCoordTransform", layerTexCoordScale.x, layerTexCoordScale.y,
+                    (layer % 4 - 1.5f) / SCR_WIDTH, (layer / 4 - 1.5f) / SCR_HEIGHT);
+                renderQuad();
+            }
+            glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+            glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+            shaderReinterleave.use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, aoLayers);
+            renderQuad();
+        };
+
+        // dispatches an AO compute shader the caller has already set up over a technique's AO buffer,
+        // with a fused blur the buffer already holds the blurred AO afterwards
+        auto dispatchComputeAO = [&](Shader& shader, unsigned int colorBuffer, int resolution, int blurRadius) {
+            shader.setBool("fuseBlur", fuseComputeBlur);
+            shader.setInt("blurRadius", std::min(blurRadius, COMPUTE_BLUR_APRON));
+            shader.setFloat("depthSharpness", blurDepthSharpness);
+            shader.setBool("useNormals", blurNormals);
+            glExtensions.bindImageTexture(0, colorBuffer, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R16F);
+            glExtensions.dispatchCompute((aoWidth(resolution) + COMPUTE_TILE_SIZE - 1) / COMPUTE_TILE_SIZE,
+                (aoHeight(resolution) + COMPUTE_TILE_SIZE - 1) / COMPUTE_TILE_SIZE, 1);
+            // the blur, upsample and lighting passes sample the result as a texture, and the blur's vertical pass
+            // and next frame's clear write the same buffer through its framebuffer
+            glExtensions.memoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+        };
+        // the separate blur passes are skipped when the compute AO dispatch already blurred
+        bool blurFused = enableComputeAO && fuseComputeBlur;
+
+        // permutation the active technique rendered with, recorded with the benchmark timings
+        std::string aoVariant;
 
         // SSAO-----------------------------------------------------------------------------------
         // generate SSAO texture
         if (enableSSAO) {
+            profiler.beginPass(enableComputeAO ? "SSAO Compute" : "SSAO");
+            ShaderPermutations& ssaoVariants = enableComputeAO ? shaderSSAOCompute : (deinterleaved(ss_resolution) ? shaderSSAODeinterleaved : shaderSSAO);
+            std::vector<int> ssaoVariant = { enableTemporalAO ? TEMPORAL_SAMPLES : ss_kernelSize };
+            Shader& ssaoShader = ssaoVariants.get(ssaoVariant);
+            aoVariant = ssaoVariants.label(ssaoVariant);
+            glViewport(0, 0, aoWidth(ss_resolution), aoHeight(ss_resolution));
             glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-                glClear(GL_COLOR_BUFFER_BIT);
-                shaderSSAO.use();
-                // Send kernel + rotation 
-                for (unsigned int i = 0; i < 16; ++i)
-                    shaderSSAO.setVec3("samples[" + std::to_string(i) + "]", ssaoKernel[i]);
-                shaderSSAO.setMat4("projection", projection);
-                shaderSSAO.setInt("kernelSize", ss_kernelSize);
-                shaderSSAO.setFloat("radius", ss_radius);
-                shaderSSAO.setFloat("bias", ss_bias);
+                if (!enableComputeAO) // the dispatch writes every texel
+                    glClear(GL_COLOR_BUFFER_BIT);
+                ssaoShader.use();
+                ssaoShader.setFloat("temporalRotation", temporalRotation);
+                ssaoShader.setInt("temporalFrameSlot", temporalFrameSlot);
+                ssaoShader.setInt("temporalSampleStride", temporalSampleStride);
+                ssaoShader.setFloat("radius", ss_radius);
+                ssaoShader.setFloat("bias", ss_bias);
                 glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, gPosition);
+                glBindTexture(GL_TEXTURE_2D, gViewPosition);
                 glActiveTexture(GL_TEXTURE1);
                 glBindTexture(GL_TEXTURE_2D, gNormal);
                 glActiveTexture(GL_TEXTURE2);
                 glBindTexture(GL_TEXTURE_2D, noiseTexture);
-                renderQuad();
+                glActiveTexture(GL_TEXTURE3);
+                glBindTexture(GL_TEXTURE_2D, depthPyramid);
+                if (enableComputeAO)
+                    dispatchComputeAO(ssaoShader, ssaoColorBuffer, ss_resolution, ss_blurRadius);
+                else if (deinterleaved(ss_resolution))
+                    renderDeinterleavedAO(ssaoShader, ssaoFBO);
+                else
+                    renderQuad();
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
+            profiler.endPass();
         }
         // blur SSAO texture to remove noise
         if (enableSSAO){
-            glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
-                glClear(GL_COLOR_BUFFER_BIT);
-                shaderSSAOBlur.use();
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
-                renderQuad();
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            if (!blurFused) {
+                profiler.beginPass("SSAO Blur");
+                blurAO(shaderAOBlur, ssaoFBO, ssaoColorBuffer, ssaoBlurFBO, ssaoColorBufferBlur, ss_blurRadius);
+                profiler.endPass();
+            }
+            glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+            aoResult = upsampleAO(ssaoColorBuffer, ss_resolution);
+            aoTechnique = 0;
         }
 
         // HBAO-----------------------------------------------------------------------------------
         // generate HBAO texture
         if (enableHBAO) {
+            profiler.beginPass(enableComputeAO ? "HBAO Compute" : "HBAO");
+            ShaderPermutations& hbaoVariants = enableComputeAO ? shaderHBAOCompute : (deinterleaved(hb_resolution) ? shaderHBAODeinterleaved : shaderHBAO);
+            std::vector<int> hbaoVariant = { hb_directions, hb_samples };
+            Shader& hbaoShader = hbaoVariants.get(hbaoVariant);
+            aoVariant = hbaoVariants.label(hbaoVariant);
+            glViewport(0, 0, aoWidth(hb_resolution), aoHeight(hb_resolution));
             glBindFramebuffer(GL_FRAMEBUFFER, hbaoFBO);
-            glClear(GL_COLOR_BUFFER_BIT);
-            shaderHBAO.use();
-            shaderHBAO.setMat4("projection", projection);
-            shaderHBAO.setMat4("view", view); 
-            shaderHBAO.setFloat("radius", hb_radius);
-            shaderHBAO.setFloat("bias", hb_bias);
-            shaderHBAO.setInt("samples", hb_samples);
+            if (!enableComputeAO) // the dispatch writes every texel
+                glClear(GL_COLOR_BUFFER_BIT);
+            hbaoShader.use();
+            hbaoShader.setFloat("radius", hb_radius);
+            hbaoShader.setFloat("bias", hb_bias);
+            hbaoShader.setFloat("temporalRotation", temporalRotation);
             glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, gPosition);
+            glBindTexture(GL_TEXTURE_2D, gViewPosition);
             glActiveTexture(GL_TEXTURE1);
             glBindTexture(GL_TEXTURE_2D, gNormal);
             glActiveTexture(GL_TEXTURE2);
             glBindTexture(GL_TEXTURE_2D, hbaoNoiseTexture);
-            renderQuad();
+            glActiveTexture(GL_TEXTURE3);
+            glBindTexture(GL_TEXTURE_2D, depthPyramid);
+            if (enableComputeAO)
+                dispatchComputeAO(hbaoShader, hbaoColorBuffer, hb_resolution, hb_blurRadius);
+            else if (deinterleaved(hb_resolution))
+                renderDeinterleavedAO(hbaoShader, hbaoFBO);
+            else
+                renderQuad();
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            profiler.endPass();
         }
         //  blur HBAO texture to remove noise
         if (enableHBAO) {
-            glBindFramebuffer(GL_FRAMEBUFFER, hbaoBlurFBO);
-            glClear(GL_COLOR_BUFFER_BIT);
-            shaderHBAOBlur.use();
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, hbaoColorBuffer);
-            renderQuad();
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            if (!blurFused) {
+                profiler.beginPass("HBAO Blur");
+                blurAO(shaderAOBlur, hbaoFBO, hbaoColorBuffer, hbaoBlurFBO, hbaoColorBufferBlur, hb_blurRadius);
+                profiler.endPass();
+            }
+            glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+            aoResult = upsampleAO(hbaoColorBuffer, hb_resolution);
+            aoTechnique = 1;
         }
         
         // ALCHAO---------------------------------------------------------------------------------
         // generate ALCHAO texture
         if (enableALCHAO) {
+            profiler.beginPass(enableComputeAO ? "ALCHAO Compute" : "ALCHAO");
+            ShaderPermutations& alchaoVariants = enableComputeAO ? shaderALCHAOCompute : (deinterleaved(al_resolution) ? shaderALCHAODeinterleaved : shaderALCHAO);
+            std::vector<int> alchaoVariant = { enableTemporalAO ? TEMPORAL_SAMPLES : al_kernelSize, al_k };
+            Shader& alchaoShader = alchaoVariants.get(alchaoVariant);
+            aoVariant = alchaoVariants.label(alchaoVariant);
+            glViewport(0, 0, aoWidth(al_resolution), aoHeight(al_resolution));
             glBindFramebuffer(GL_FRAMEBUFFER, alchaoFBO);
-            glClear(GL_COLOR_BUFFER_BIT);
-            shaderALCHAO.use();
-            // Send kernel + rotation 
-            for (unsigned int i = 0; i < 16; ++i)
-                shaderALCHAO.setVec3("samples[" + std::to_string(i) + "]", ssaoKernel[i]);
-            shaderALCHAO.setMat4("projection", projection);
-            shaderALCHAO.setInt("kernelSize", al_kernelSize);
-            shaderALCHAO.setFloat("radius", al_radius);
-            shaderALCHAO.setFloat("bias", al_bias);
-            shaderALCHAO.setFloat("sigma", al_sigma);
-            shaderALCHAO.setInt("k", al_k);
-            shaderALCHAO.setFloat("beta", al_beta);
-            shaderALCHAO.setFloat("turns", al_turns);
+            if (!enableComputeAO) // the dispatch writes every texel
+                glClear(GL_COLOR_BUFFER_BIT);
+            alchaoShader.use();
+            alchaoShader.setFloat("temporalRotation", temporalRotation);
+            alchaoShader.setInt("temporalFrameSlot", temporalFrameSlot);
+            alchaoShader.setInt("temporalSampleStride", temporalSampleStride);
+            alchaoShader.setFloat("radius", al_radius);
+            alchaoShader.setFloat("bias", al_bias);
+            alchaoShader.setFloat("sigma", al_sigma);
+            alchaoShader.setFloat("beta", al_beta);
+            alchaoShader.setFloat("turns", al_turns);
             glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, gPosition);
+            glBindTexture(GL_TEXTURE_2D, gViewPosition);
             glActiveTexture(GL_TEXTURE1);
             glBindTexture(GL_TEXTURE_2D, gNormal);
             glActiveTexture(GL_TEXTURE2);
             glBindTexture(GL_TEXTURE_2D, noiseTexture);
-            renderQuad();
+            glActiveTexture(GL_TEXTURE3);
+            glBindTexture(GL_TEXTURE_2D, depthPyramid);
+            if (enableComputeAO)
+                dispatchComputeAO(alchaoShader, alchaoColorBuffer, al_resolution, al_blurRadius);
+            else if (deinterleaved(al_resolution))
+                renderDeinterleavedAO(alchaoShader, alchaoFBO);
+            else
+                renderQuad();
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            profiler.endPass();
         }
         // blur ALCHAO texture to remove noise
         if (enableALCHAO) {
-            bool horizontal = true, first_iteration = true;
-            int amount = 10; // Number of blur iterations
-            shaderALCHAOBlur.use();
-            for (unsigned int i = 0; i < amount; i++)
-            {
-                glBindFramebuffer(GL_FRAMEBUFFER, horizontal ? alchaoBlurFBO : alchaoFBO);
-                shaderALCHAOBlur.setInt("horizontal", horizontal);
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, first_iteration ? alchaoColorBuffer : alchaoColorBufferBlur);
-                renderQuad();
-                horizontal = !horizontal;
-                if (first_iteration)
-                    first_iteration = false;
+            if (!blurFused) {
+                profiler.beginPass("ALCHAO Blur");
+                blurAO(shaderAOBlur, alchaoFBO, alchaoColorBuffer, alchaoBlurFBO, alchaoColorBufferBlur, al_blurRadius);
+                profiler.endPass();
             }
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+            aoResult = upsampleAO(alchaoColorBuffer, al_resolution);
+            aoTechnique = 2;
         }
         
+        benchmark.variant = aoVariant;
+
+        // TEMPORAL AO----------------------------------------------------------------------------
+        // blend this frame's AO into the reprojected history, history from another technique is discarded
+        if (enableTemporalAO && aoTechnique >= 0) {
+            profiler.beginPass("AO Temporal");
+            int previous = temporalCurrent;
+            temporalCurrent = 1 - temporalCurrent;
+            glBindFramebuffer(GL_FRAMEBUFFER, temporalFBO[temporalCurrent]);
+            shaderAOTemporal.use();
+            shaderAOTemporal.setMat4("prevViewProjection", prevProjection * prevView);
+            shaderAOTemporal.setBool("historyValid", temporalTechnique == aoTechnique);
+            shaderAOTemporal.setFloat("minBlend", temporalBlend);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, gViewPosition);
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, aoResult);
+            glActiveTexture(GL_TEXTURE3);
+            glBindTexture(GL_TEXTURE_2D, temporalHistory[previous]);
+            renderQuad();
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            profiler.endPass();
+            aoResult = temporalHistory[temporalCurrent];
+            temporalTechnique = aoTechnique;
+            temporalFrame++;
+        }
+        else
+            temporalTechnique = -1;
+        prevView = view;
+        prevProjection = projection;
+
         //  lighting pass
+        profiler.beginPass("Lighting");
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         shaderLightingPass.use();
-        shaderLightingPass.setMat4("invView", glm::inverse(camera.GetViewMatrix()));
-        glm::vec3 camPosition = camera.Position; 
-        shaderLightingPass.setVec3("viewPos", camPosition);
-
-        for (int i = 0; i < lightPositions.size(); ++i) {
-            shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].Position", lightPositions[i]);
-            shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].Color", lightColors[i]);
-            const float linear = 0.09f;
-            const float quadratic = 0.01f;
-            shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].Linear", linear);       // Assuming all lights have the same
-            shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].Quadratic", quadratic); // attenuation factors.
-        }
-
+        shaderLightingPass.setInt("debugView", debugView);
 
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gPosition);
+        glBindTexture(GL_TEXTURE_2D, gViewPosition);
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, gNormal);
         glActiveTexture(GL_TEXTURE2);
         glBindTexture(GL_TEXTURE_2D, gAlbedo);
 
         glActiveTexture(GL_TEXTURE3);  
-        
-        if (enableSSAO) {
-            glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur); 
-        }
-        else if (enableHBAO) {
-            glBindTexture(GL_TEXTURE_2D, hbaoColorBufferBlur); 
-        }
-        else if (enableALCHAO) {
-            glBindTexture(GL_TEXTURE_2D, alchaoColorBufferBlur); 
-        }
-        else {
-            glBindTexture(GL_TEXTURE_2D, whiteTexture);
-        }
+        glBindTexture(GL_TEXTURE_2D, aoResult);
         
         renderQuad();
+        profiler.endPass();
 
 
         if (showGui)
         {
+            profiler.beginPass("GUI");
             ImGui_ImplOpenGL3_NewFrame();
             ImGui_ImplGlfw_NewFrame();
             ImGui::NewFrame();
-            ImGui::SetNextWindowSize(ImVec2(400.0f, 200.0f));  // Width, Height
+            ImGui::SetNextWindowSize(ImVec2(400.0f, 580.0f));  // Width, Height
 
 
             // Calculate and display FPS
@@ -734,24 +1469,84 @@ int main()
             ImGui::Checkbox("HBAO (2)", &enableHBAO); 
             ImGui::Checkbox("ALCHAO (3)", &enableALCHAO); 
             ImGui::Checkbox("Texture (T)", &enableTextures); 
+            ImGui::Checkbox("Frustum culling", &enableFrustumCulling);
+            ImGui::Checkbox("Depth pre-pass", &enableDepthPrepass);
+            ImGui::SameLine();
+            ImGui::Checkbox("Front to back", &enableFrontToBack);
+            ImGui::Text("Meshes: %d visible, %d culled, %d draw calls", sponzaModel.visibleMeshCount(),
+                (int)sponzaModel.meshes.size() - sponzaModel.visibleMeshCount(), sponzaModel.drawCallCount());
+            ImGui::Combo("View", &debugView, "Lit\0Normals\0AO\0");
+            ImGui::Checkbox("Deinterleaved AO (full resolution only)", &enableDeinterleaving);
+            ImGui::Checkbox("Temporal AO (4 samples per frame)", &enableTemporalAO);
+            ImGui::SliderFloat("Temporal blend", &temporalBlend, 0.01f, 1.0f);
+            if (glExtensions.computeShaders) {
+                ImGui::Checkbox("Compute AO (shared memory tiles)", &enableComputeAO);
+                ImGui::Checkbox("Fuse blur into compute AO (radius <= 4)", &fuseComputeBlur);
+            }
+            else
+                ImGui::Text("Compute AO: needs OpenGL 4.3");
+            ImGui::Text("Normals: %s (mean error %.4f deg, max %.4f deg)", normalFormat.name,
+                normalErrors[options.normalEncoding].meanDegrees, normalErrors[options.normalEncoding].maxDegrees);
             ImGui::Text("Cycle Through Preset Cameras (Z)");
+            if (benchmark.running)
+                ImGui::Text("Benchmark: preset %d, %s", benchmark.currentPreset, aoSettingNames[benchmark.currentAOSetting].c_str());
+            else
+                ImGui::Text("Run Benchmark (K)");
             glm::vec3 camPos = camera.Position; 
             ImGui::Text("Camera Position:"); 
             ImGui::Text("X: %.2f", camPos.x); 
             ImGui::Text("Y: %.2f", camPos.y); 
             ImGui::Text("Z: %.2f", camPos.z); 
+            // what the camera looks at and how close it is to the scene, queried in the model's space through its BVH,
+            // only on request and never while benchmarking so neither the queries nor the lazy triangle BVH builds
+            // end up in the timings
+            ImGui::Checkbox("Surface queries", &showSurfaceQueries);
+            if (showSurfaceQueries && !benchmark.running) {
+                glm::mat4 worldToModel = glm::inverse(model);
+                glm::vec3 modelEye = glm::vec3(worldToModel * glm::vec4(camera.Position, 1.0f));
+                glm::vec3 modelFront = glm::vec3(worldToModel * glm::vec4(camera.Front, 0.0f));
+                float surfaceAhead = 1000.0f, clearance = 1000.0f / glm::length(glm::vec3(model[0]));
+                glm::vec3 closestSurface;
+                size_t surfaceMesh;
+                if (sponzaModel.raycast(modelEye, modelFront, surfaceAhead, surfaceMesh))
+                    ImGui::Text("Surface ahead: %.2f (mesh %d)", surfaceAhead, (int)surfaceMesh);
+                if (sponzaModel.nearestSurface(modelEye, clearance, closestSurface, surfaceMesh))
+                    ImGui::Text("Nearest surface: %.2f", clearance * glm::length(glm::vec3(model[0])));
+            }
+            ImGui::Text("Mesh BVH: %d nodes, SAH cost %.1f", (int)sponzaModel.meshHierarchy().nodeArray().size(), sponzaModel.meshHierarchy().cost());
+
+            // GPU PASS TIMINGS
+            ImGui::Separator();
+            ImGui::Text("GPU Timings (ms)       min     avg     p99");
+            for (const GpuPassStats& pass : profiler.stats())
+                ImGui::Text("%-18s %7.3f %7.3f %7.3f", pass.name.c_str(), pass.minMs, pass.avgMs, pass.p99Ms);
+            // samples passing the depth test per screen pixel, the G-buffer pass' is its shaded fragments
+            for (const GpuSampleStats& counter : profiler.sampleStats())
+                ImGui::Text("Overdraw %-16s %6.2fx", counter.name.c_str(), counter.avgSamples / ((double)SCR_WIDTH * SCR_HEIGHT));
+            ImGui::Text("State calls (last frame)  issued  skipped");
+            static const char* stateCallNames[STATE_CALL_COUNT] = { "Program", "Active texture", "Texture", "Vertex array", "Sampler uniform" };
+            const GLStateCache::Counters& stateCalls = glState().lastFrame();
+            for (int i = 0; i < STATE_CALL_COUNT; i++)
+                ImGui::Text("%-24s %7d %8d", stateCallNames[i], stateCalls.issued[i], stateCalls.skipped[i]);
             
             // SLIDERS SSAO
             ImGui::Separator();
             ImGui::Text("SSAO Parameters");
             ImGui::SliderFloat("SSAO radius", &ss_radius, 0.0f, 100.f);
             ImGui::SliderFloat("SSAO bias", &ss_bias, 0.f, 1.f);
+            ImGui::SliderInt("SSAO kernel size", &ss_kernelSize, 1, 16);
+            ImGui::Combo("SSAO resolution", &ss_resolution, "Full\0Half\0Quarter\0");
+            ImGui::SliderInt("SSAO blur radius", &ss_blurRadius, 0, 16);
 
             // SLIDERS HBAO
             ImGui::Separator();
             ImGui::Text("HBAO Parameters");
             ImGui::SliderFloat("HBAO Radius", &hb_radius, 0.0f, 1000000.0f);
             ImGui::SliderFloat("HBAO Bias", &hb_bias, 0.0f, 40.0f);
+            ImGui::SliderInt("HBAO directions", &hb_directions, 1, 8);
+            ImGui::SliderInt("HBAO samples", &hb_samples, 2, 16);
+            ImGui::Combo("HBAO resolution", &hb_resolution, "Full\0Half\0Quarter\0");
+            ImGui::SliderInt("HBAO blur radius", &hb_blurRadius, 0, 16);
 
             // SLIDERS ALCHAO
             ImGui::Separator();
@@ -759,30 +1554,57 @@ int main()
             ImGui::SliderFloat("ALCHAO radius", &al_radius, 0.0f, 20.f);
             ImGui::SliderFloat("ALCHAO bias", &al_bias, 0.f, 1.f);
             ImGui::SliderFloat("ALCHAO sigma", &al_sigma, 0.f, 20.f);
+            ImGui::SliderInt("ALCHAO kernel size", &al_kernelSize, 1, 32);
             ImGui::SliderInt("ALCHAO k", &al_k, 0, 10);
             ImGui::InputFloat("ALCHAO beta", &al_beta, 0.f, 0.001f, "%.6f");
             ImGui::SliderFloat("ALCHAO turns", &al_turns , 0.f, 30.f);
+            ImGui::Combo("ALCHAO resolution", &al_resolution, "Full\0Half\0Quarter\0");
+            ImGui::SliderInt("ALCHAO blur radius", &al_blurRadius, 0, 16);
+
+            // SLIDERS AO BLUR
+            ImGui::Separator();
+            ImGui::Text("AO Blur Parameters");
+            ImGui::SliderFloat("Blur depth sharpness", &blurDepthSharpness, 0.0f, 64.0f);
+            ImGui::Checkbox("Blur normal weights", &blurNormals);
 
             ImGui::End();
 
             ImGui::Render();
             ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            profiler.endPass();
         }
+
+        profiler.endFrame();
         
 
+        // wait for the GPU while benchmarking so each frame time covers the whole frame's work
+        if (benchmark.running)
+            glFinish();
+
         // glfw swap buffers and poll IO events 
         glfwSwapBuffers(window);
         glfwPollEvents();
+
+        if (firstFrame)
+        {
+            std::cout << "First frame after " << glfwGetTime() << " s, " << shaders.linkedCount() << " of " << shaders.programCount() << " shader programs linked"
+                << (shaders.parallelCompile() ? " (parallel compile)" : "") << std::endl;
+            std::cout << programBinaryCache().summary() << std::endl;
+            firstFrame = false;
+        }
     }
 
     // shutdown imgui
+    if (!options.headless)
+    {
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplGlfw_Shutdown();
+        ImGui::DestroyContext();
+    }
 
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
-    ImGui::DestroyContext();
-
+    textureStreamer().release();
     glfwTerminate();
-    return 0;
+    return exitCode;
 }
 
 
@@ -949,19 +1771,11 @@ void processInput(GLFWwindow* window)
         lPressed = false;
     }
 
-    // Start FPS Test [K]
+    // Start Benchmark [K]
     static bool kPressed = false;
-    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS && !kPressed) {
-        isTesting = true; 
-        currentPresetIndex = -1;
-        currentAOSetting = 0;
-        elapsedTime = 0.0f;
-        fpsSum = 0.0f;
-        frameCount = 0;
+    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS && !kPressed && !benchmark.running) {
         kPressed = true; 
-
-        switchCameraPreset(camera); 
-        applyAOSetting(currentAOSetting); 
+        startBenchmark(camera);
     }
     if (glfwGetKey(window, GLFW_KEY_K) == GLFW_RELEASE) {
         kPressed = false; 
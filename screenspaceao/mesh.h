@@ -11,68 +11,142 @@ Adjusted for needs of this application
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/shader_s.h>
 
+#include <cstdint>
 #include <string>
 #include <vector>
 using namespace std;
 
-#define MAX_BONE_INFLUENCE 4
-
+// every attribute but the position, which lives in a stream of its own so depth-only passes fetch nothing else
+// (12 bytes here plus 12 of position, against 88 for the float layout with bone data no model here has)
 struct Vertex {
-    // position
-    glm::vec3 Position;
-    // normal
-    glm::vec3 Normal;
-    // texCoords
-    glm::vec2 TexCoords;
-    // tangent
-    glm::vec3 Tangent;
-    // bitangent
-    glm::vec3 Bitangent;
-    //bone indexes which will influence this vertex
-    int m_BoneIDs[MAX_BONE_INFLUENCE];
-    //weights from each bone
-    float m_Weights[MAX_BONE_INFLUENCE];
+    // normal, snorm 10:10:10:2
+    std::uint32_t Normal;
+    // tangent, snorm 10:10:10:2 with the bitangent's sign in w: bitangent = cross(normal, tangent) * w
+    std::uint32_t Tangent;
+    // texCoords, two half floats
+    std::uint32_t TexCoords;
 };
 
+inline Vertex packVertex(const glm::vec3& normal, const glm::vec2& texCoords, const glm::vec3& tangent, const glm::vec3& bitangent)
+{
+    float handedness = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+    Vertex vertex;
+    vertex.Normal = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+    vertex.Tangent = glm::packSnorm3x10_1x2(glm::vec4(tangent, handedness));
+    vertex.TexCoords = glm::packHalf2x16(texCoords);
+    return vertex;
+}
+
 struct Texture {
     unsigned int id;
     string type;
     string path;
 };
 
+// one mesh of a Model, whose shared buffers hold its vertices and indices (see Model::uploadMeshes)
 class Mesh {
 public:
-    // mesh Data
+    // mesh Data, kept from an import, empty when the mesh came from a mapped mesh cache
+    vector<glm::vec3>    positions;
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
-    unsigned int VAO;
+    // where the mesh lives in its model's buffers
+    unsigned int vertexCount = 0;
+    unsigned int indexCount = 0;
+    int baseVertex = 0;
+    unsigned int firstIndex = 0;
+    // model-space bounding box
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
 
     // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    Mesh(vector<glm::vec3> positions, vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
     {
+        this->positions = positions;
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        vertexCount = static_cast<unsigned int>(this->vertices.size());
+        indexCount = static_cast<unsigned int>(this->indices.size());
+    }
 
-        // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+    // constructor for a mesh whose data is uploaded from elsewhere (e.g. a mapped mesh cache) without keeping a copy
+    Mesh(size_t vertexCount, size_t indexCount, vector<Texture> textures)
+    {
+        this->textures = textures;
+        this->vertexCount = static_cast<unsigned int>(vertexCount);
+        this->indexCount = static_cast<unsigned int>(indexCount);
+    }
+
+    // bounding box of the mesh's vertexCount positions
+    void computeBounds(const glm::vec3* positionData)
+    {
+        if (vertexCount == 0)
+            return;
+        boundsMin = boundsMax = positionData[0];
+        for (unsigned int i = 1; i < vertexCount; i++)
+        {
+            boundsMin = glm::min(boundsMin, positionData[i]);
+            boundsMax = glm::max(boundsMax, positionData[i]);
+        }
+    }
+
+    // binds the mesh's textures and points the shader's samplers at them, skipping what is already bound (see gl_state.h)
+    void bindTextures(Shader& shader)
+    {
+        // sampler handles are resolved once per program rather than on every draw
+        if (samplerProgram != shader.ID)
+            resolveSamplers(shader);
+
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            // set the sampler to the texture unit
+            glState().setSampler(shader.ID, samplers[i].location, (int)i);
+            // and bind the texture to it
+            glState().bindTexture((int)i, textures[i].id);
+        }
     }
 
-    // render the mesh
-    void Draw(Shader& shader)
+    // orders meshes by the textures they bind, unit by unit, so neighbours in a sorted queue share as many as possible
+    bool materialBefore(const Mesh& other) const
+    {
+        for (size_t i = 0; i < textures.size() && i < other.textures.size(); i++)
+            if (textures[i].id != other.textures[i].id)
+                return textures[i].id < other.textures[i].id;
+        return textures.size() < other.textures.size();
+    }
+
+    // whether both meshes bind the same textures the same way, so they can be drawn together
+    bool sameMaterial(const Mesh& other) const
+    {
+        if (textures.size() != other.textures.size())
+            return false;
+        for (size_t i = 0; i < textures.size(); i++)
+            if (textures[i].id != other.textures[i].id || textures[i].type != other.textures[i].type)
+                return false;
+        return true;
+    }
+
+private:
+    // sampler of each texture in the program they were last resolved for
+    unsigned int samplerProgram = 0;
+    vector<UniformHandle<int>> samplers;
+
+    // looks up the sampler each texture binds to (texture_diffuseN, texture_specularN, ...)
+    void resolveSamplers(const Shader& shader)
     {
-        // bind appropriate textures
         unsigned int diffuseNr = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr = 1;
         unsigned int heightNr = 1;
+        samplers.clear();
         for (unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -84,69 +158,9 @@ public:
                 number = std::to_string(normalNr++); // transfer unsigned int to string
             else if (name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to string
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            samplers.push_back(shader.uniform<int>(name + number));
         }
-
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
-    }
-
-private:
-    // render data 
-    unsigned int VBO, EBO;
-
-    // initializes all the buffer objects/arrays
-    void setupMesh()
-    {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        // A great thing about structs is that their memory layout is sequential for all its items.
-        // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
-        // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-        // ids
-        glEnableVertexAttribArray(5);
-        glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
-
-        // weights
-        glEnableVertexAttribArray(6);
-        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-        glBindVertexArray(0);
+        samplerProgram = shader.ID;
     }
 };
 #endif
\ No newline at end of file
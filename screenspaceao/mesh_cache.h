@@ -0,0 +1,296 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+/*
+Binary mesh cache written next to a model after its first Assimp import
+Layout: header, mesh table, material table (runs of texture references, each a texture and the
+sampler type it is bound as), texture table (paths in the string blob), then 16 byte aligned position, vertex and index blobs,
+the meshes as mesh_optimizer.h left them, with 16 or 32-bit indices for the whole model. Model maps the file on later runs
+and hands the blobs straight to glBufferData, nothing is parsed or copied.
+A cache whose version, Vertex layout or import flags differ, or whose model file changed size or
+modification time, is ignored and rewritten
+*/
+
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/mesh.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/file_stamp.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include <sys/stat.h>
+
+const std::uint32_t MESH_CACHE_VERSION = 3;
+
+struct MeshCacheHeader {
+    char magic[4];                // "SSMC"
+    std::uint32_t version;        // MESH_CACHE_VERSION
+    std::uint32_t vertexSize;     // sizeof(Vertex) when written
+    std::uint32_t importFlags;    // Assimp post-processing the data went through
+    std::uint64_t sourceSize;     // model file size and modification time when imported
+    std::int64_t sourceTime;
+    std::uint32_t meshCount;
+    std::uint32_t materialCount;
+    std::uint32_t materialTextureCount;
+    std::uint32_t textureCount;
+    std::uint32_t indexSize;      // bytes per index of every mesh, 2 or 4
+    std::uint32_t pad;
+    std::uint64_t meshOffset;             // MeshCacheMesh[meshCount]
+    std::uint64_t materialOffset;         // MeshCacheMaterial[materialCount]
+    std::uint64_t materialTextureOffset;  // MeshCacheMaterialTexture[materialTextureCount], the materials' runs point into it
+    std::uint64_t textureOffset;          // MeshCacheTexture[textureCount]
+    std::uint64_t stringOffset;           // texture types and paths
+    std::uint64_t stringSize;
+    std::uint64_t fileSize;
+};
+
+struct MeshCacheMesh {
+    std::uint32_t materialIndex;
+    std::uint32_t vertexCount;
+    std::uint32_t indexCount;
+    std::uint32_t pad;
+    std::uint64_t positionOffset; // glm::vec3[vertexCount]
+    std::uint64_t vertexOffset;   // Vertex[vertexCount]
+    std::uint64_t indexOffset;    // uint16 or uint32[indexCount], see MeshCacheHeader::indexSize
+};
+
+struct MeshCacheMaterial {
+    std::uint32_t firstTexture;  // into the material textures
+    std::uint32_t textureCount;
+};
+
+struct MeshCacheMaterialTexture {
+    std::uint32_t texture;       // into the texture table
+    std::uint32_t typeOffset;    // into the string blob, e.g. "texture_diffuse"
+    std::uint32_t typeLength;
+    std::uint32_t pad;
+};
+
+struct MeshCacheTexture {
+    std::uint32_t pathOffset;    // into the string blob, relative to the model's directory
+    std::uint32_t pathLength;
+};
+
+// read-only mapping of a whole file, unmapped on destruction
+class MappedFile
+{
+public:
+    MappedFile(const std::string& path)
+    {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+            return;
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping)
+            return;
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view)
+            return;
+        bytes = (const char*)view;
+        length = (size_t)fileSize.QuadPart;
+#else
+        descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            return;
+        struct stat info;
+        if (fstat(descriptor, &info) != 0 || info.st_size == 0)
+            return;
+        void* view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (view == MAP_FAILED)
+            return;
+        bytes = (const char*)view;
+        length = (size_t)info.st_size;
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (bytes)
+            UnmapViewOfFile(bytes);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+#else
+        if (bytes)
+            munmap((void*)bytes, length);
+        if (descriptor >= 0)
+            close(descriptor);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    // whether [offset, offset + count * sizeof(T)) lies inside the file
+    template <typename T>
+    bool contains(std::uint64_t offset, std::uint64_t count) const
+    {
+        return bytes && offset <= length && count <= (length - offset) / sizeof(T);
+    }
+
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int descriptor = -1;
+#endif
+};
+
+// writes the imported meshes of a model and the textures they use (paths relative to the model's directory),
+// indices narrowed to indexSize bytes
+inline bool writeMeshCache(const std::string& cachePath, std::uint32_t importFlags, std::uint64_t sourceSize, std::int64_t sourceTime,
+    const std::vector<Mesh>& meshes, const std::vector<Texture>& textures, std::uint32_t indexSize)
+{
+    auto align = [](std::uint64_t offset) { return (offset + 15) & ~(std::uint64_t)15; };
+
+    std::string strings;
+    auto addString = [&strings](const std::string& text, std::uint32_t& offset, std::uint32_t& length) {
+        offset = (std::uint32_t)strings.size();
+        length = (std::uint32_t)text.size();
+        strings += text;
+    };
+
+    std::vector<MeshCacheTexture> textureTable;
+    for (const Texture& texture : textures)
+    {
+        MeshCacheTexture entry;
+        addString(texture.path, entry.pathOffset, entry.pathLength);
+        textureTable.push_back(entry);
+    }
+
+    // materials are the distinct texture sets of the meshes, (texture, type) pairs in binding order
+    std::vector<std::vector<std::pair<std::uint32_t, std::string>>> materials;
+    std::vector<std::uint32_t> meshMaterials;
+    for (const Mesh& mesh : meshes)
+    {
+        std::vector<std::pair<std::uint32_t, std::string>> set;
+        for (const Texture& texture : mesh.textures)
+            for (size_t i = 0; i < textures.size(); i++)
+                if (textures[i].id == texture.id)
+                {
+                    set.push_back({ (std::uint32_t)i, texture.type });
+                    break;
+                }
+        size_t material = 0;
+        while (material < materials.size() && materials[material] != set)
+            material++;
+        if (material == materials.size())
+            materials.push_back(set);
+        meshMaterials.push_back((std::uint32_t)material);
+    }
+
+    std::vector<MeshCacheMaterial> materialTable;
+    std::vector<MeshCacheMaterialTexture> materialTextures;
+    for (const auto& material : materials)
+    {
+        materialTable.push_back({ (std::uint32_t)materialTextures.size(), (std::uint32_t)material.size() });
+        for (const auto& reference : material)
+        {
+            MeshCacheMaterialTexture entry = {};
+            entry.texture = reference.first;
+            addString(reference.second, entry.typeOffset, entry.typeLength);
+            materialTextures.push_back(entry);
+        }
+    }
+
+    MeshCacheHeader header = {};
+    std::memcpy(header.magic, "SSMC", 4);
+    header.version = MESH_CACHE_VERSION;
+    header.vertexSize = sizeof(Vertex);
+    header.importFlags = importFlags;
+    header.sourceSize = sourceSize;
+    header.sourceTime = sourceTime;
+    header.meshCount = (std::uint32_t)meshes.size();
+    header.materialCount = (std::uint32_t)materialTable.size();
+    header.materialTextureCount = (std::uint32_t)materialTextures.size();
+    header.textureCount = (std::uint32_t)textureTable.size();
+    header.indexSize = indexSize;
+    header.meshOffset = align(sizeof(MeshCacheHeader));
+    header.materialOffset = align(header.meshOffset + meshes.size() * sizeof(MeshCacheMesh));
+    header.materialTextureOffset = align(header.materialOffset + materialTable.size() * sizeof(MeshCacheMaterial));
+    header.textureOffset = align(header.materialTextureOffset + materialTextures.size() * sizeof(MeshCacheMaterialTexture));
+    header.stringOffset = align(header.textureOffset + textureTable.size() * sizeof(MeshCacheTexture));
+    header.stringSize = strings.size();
+
+    std::vector<MeshCacheMesh> meshTable;
+    std::uint64_t blobOffset = align(header.stringOffset + strings.size());
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        MeshCacheMesh entry = {};
+        entry.materialIndex = meshMaterials[i];
+        entry.vertexCount = (std::uint32_t)meshes[i].vertices.size();
+        entry.indexCount = (std::uint32_t)meshes[i].indices.size();
+        entry.positionOffset = blobOffset;
+        blobOffset = align(blobOffset + entry.vertexCount * sizeof(glm::vec3));
+        entry.vertexOffset = blobOffset;
+        blobOffset = align(blobOffset + entry.vertexCount * sizeof(Vertex));
+        entry.indexOffset = blobOffset;
+        blobOffset = align(blobOffset + (std::uint64_t)entry.indexCount * indexSize);
+        meshTable.push_back(entry);
+    }
+    header.fileSize = blobOffset;
+
+    std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        return false;
+    auto writeAt = [&file](std::uint64_t offset, const void* data, size_t size) {
+        static const char padding[16] = {};
+        std::uint64_t position = (std::uint64_t)file.tellp();
+        if (offset > position)
+            file.write(padding, (std::streamsize)(offset - position));
+        if (size > 0)
+            file.write((const char*)data, (std::streamsize)size);
+    };
+    writeAt(0, &header, sizeof(header));
+    writeAt(header.meshOffset, meshTable.data(), meshTable.size() * sizeof(MeshCacheMesh));
+    writeAt(header.materialOffset, materialTable.data(), materialTable.size() * sizeof(MeshCacheMaterial));
+    writeAt(header.materialTextureOffset, materialTextures.data(), materialTextures.size() * sizeof(MeshCacheMaterialTexture));
+    writeAt(header.textureOffset, textureTable.data(), textureTable.size() * sizeof(MeshCacheTexture));
+    writeAt(header.stringOffset, strings.data(), strings.size());
+    for (size_t i = 0; i < meshes.size(); i++)
+    {
+        writeAt(meshTable[i].positionOffset, meshes[i].positions.data(), meshes[i].positions.size() * sizeof(glm::vec3));
+        writeAt(meshTable[i].vertexOffset, meshes[i].vertices.data(), meshes[i].vertices.size() * sizeof(Vertex));
+        if (indexSize == sizeof(std::uint16_t))
+        {
+            std::vector<std::uint16_t> shortIndices;
+            shortIndices.reserve(meshes[i].indices.size());
+            for (unsigned int index : meshes[i].indices)
+                shortIndices.push_back((std::uint16_t)index);
+            writeAt(meshTable[i].indexOffset, shortIndices.data(), shortIndices.size() * sizeof(std::uint16_t));
+        }
+        else
+            writeAt(meshTable[i].indexOffset, meshes[i].indices.data(), meshes[i].indices.size() * sizeof(std::uint32_t));
+    }
+    writeAt(header.fileSize, nullptr, 0);
+    return file.good();
+}
+#endif
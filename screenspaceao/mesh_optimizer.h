@@ -0,0 +1,339 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+/*
+Import-time mesh optimization
+optimizeMesh runs on every imported mesh before it is uploaded and written to the mesh cache:
+identical vertices (position and packed attributes) are welded, triangles are reordered for the
+post-transform vertex cache (Forsyth, "Linear-Speed Vertex Cache Optimisation"), clusters of those
+triangles are reordered outside-in to reduce overdraw (after Sander, Nehab and Barczak, "Fast
+Triangle Reordering for Vertex Locality and Reduced Overdraw") and vertices are renumbered in
+first-use order for fetch locality. ACMR (cache misses per triangle) and ATVR (misses per vertex)
+come from a FIFO cache simulation
+*/
+
+#include <glm/glm.hpp>
+
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+// totals of the cache simulation before and after optimizing, summed over meshes
+struct MeshOptimizationStats {
+    size_t triangles = 0;
+    size_t verticesBefore = 0, verticesAfter = 0;
+    size_t missesBefore = 0, missesAfter = 0;
+
+    void add(const MeshOptimizationStats& other)
+    {
+        triangles += other.triangles;
+        verticesBefore += other.verticesBefore;
+        verticesAfter += other.verticesAfter;
+        missesBefore += other.missesBefore;
+        missesAfter += other.missesAfter;
+    }
+
+    float acmrBefore() const { return triangles ? (float)missesBefore / triangles : 0.0f; }
+    float acmrAfter() const { return triangles ? (float)missesAfter / triangles : 0.0f; }
+    float atvrBefore() const { return verticesBefore ? (float)missesBefore / verticesBefore : 0.0f; }
+    float atvrAfter() const { return verticesAfter ? (float)missesAfter / verticesAfter : 0.0f; }
+};
+
+namespace mesh_optimization {
+
+// entries of the simulated post-transform cache, a FIFO like most hardware's
+const unsigned int SIMULATED_CACHE_SIZE = 16;
+// entries the Forsyth scores model, larger than the real cache as the paper recommends
+const int SCORED_CACHE_SIZE = 32;
+// overdraw reordering may cost at most this much vertex cache efficiency, or it is undone
+const float OVERDRAW_ACMR_THRESHOLD = 1.05f;
+
+// cache misses of drawing indices with a FIFO cache of cacheSize entries
+inline size_t simulateVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = SIMULATED_CACHE_SIZE)
+{
+    // a vertex is cached while fewer than cacheSize misses happened since it was loaded
+    std::vector<size_t> loadedAt(vertexCount, 0);
+    size_t misses = 0;
+    for (unsigned int index : indices)
+        if (loadedAt[index] == 0 || misses + 1 - loadedAt[index] > cacheSize)
+            loadedAt[index] = ++misses;
+    return misses;
+}
+
+struct WeldKey {
+    glm::vec3 position;
+    Vertex vertex;
+
+    bool operator==(const WeldKey& other) const
+    {
+        return std::memcmp(this, &other, sizeof(WeldKey)) == 0;
+    }
+};
+
+struct WeldKeyHash {
+    size_t operator()(const WeldKey& key) const
+    {
+        std::uint32_t words[6];
+        std::memcpy(words, &key, sizeof(words));
+        size_t hash = 2166136261u;
+        for (std::uint32_t word : words)
+            hash = (hash ^ word) * 16777619u;
+        return hash;
+    }
+};
+
+// merges bit-identical vertices and drops unreferenced ones, indices are rewritten to match
+inline void weldVertices(std::vector<glm::vec3>& positions, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    static_assert(sizeof(WeldKey) == 24, "WeldKey must have no padding to be compared and hashed bytewise");
+    std::unordered_map<WeldKey, unsigned int, WeldKeyHash> unique(positions.size());
+    std::vector<unsigned int> remap(positions.size(), ~0u);
+    std::vector<glm::vec3> weldedPositions;
+    std::vector<Vertex> weldedVertices;
+    for (unsigned int& index : indices)
+    {
+        if (remap[index] == ~0u)
+        {
+            WeldKey key = { positions[index], vertices[index] };
+            auto inserted = unique.insert({ key, (unsigned int)weldedPositions.size() });
+            if (inserted.second)
+            {
+                weldedPositions.push_back(positions[index]);
+                weldedVertices.push_back(vertices[index]);
+            }
+            remap[index] = inserted.first->second;
+        }
+        index = remap[index];
+    }
+    positions.swap(weldedPositions);
+    vertices.swap(weldedVertices);
+}
+
+inline float vertexScore(int cachePosition, unsigned int remainingTriangles)
+{
+    if (remainingTriangles == 0)
+        return -1.0f;
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // the last triangle's vertices score the same whatever their order, so it doesn't matter which is used first
+        if (cachePosition < 3)
+            score = 0.75f;
+        else
+            score = std::pow(1.0f - (float)(cachePosition - 3) / (SCORED_CACHE_SIZE - 3), 1.5f);
+    }
+    // vertices with few triangles left are finished first, so they leave the cache for good
+    return score + 2.0f / std::sqrt((float)remainingTriangles);
+}
+
+// reorders triangles so consecutive ones share vertices still in the post-transform cache (Forsyth)
+inline void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+        return;
+
+    // triangles of each vertex
+    std::vector<unsigned int> remaining(vertexCount, 0), adjacencyOffset(vertexCount + 1, 0), adjacency(indices.size());
+    for (unsigned int index : indices)
+        remaining[index]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+    std::vector<unsigned int> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (int c = 0; c < 3; c++)
+            adjacency[fill[indices[t * 3 + c]]++] = (unsigned int)t;
+
+    std::vector<float> score(vertexCount);
+    std::vector<int> cachePosition(vertexCount, -1);
+    for (size_t v = 0; v < vertexCount; v++)
+        score[v] = vertexScore(-1, remaining[v]);
+    std::vector<float> triangleScore(triangleCount);
+    for (size_t t = 0; t < triangleCount; t++)
+        triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+    std::vector<bool> emitted(triangleCount, false);
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    std::vector<unsigned int> cache, nextCache;
+    size_t scan = 0; // input order fallback when nothing in the cache has triangles left
+    size_t best = 0;
+    while (result.size() < triangleCount * 3)
+    {
+        for (int c = 0; c < 3; c++)
+            result.push_back(indices[best * 3 + c]);
+        emitted[best] = true;
+
+        // the triangle's vertices move to the front of the cache, the rest shift back
+        nextCache.clear();
+        for (int c = 0; c < 3; c++)
+        {
+            unsigned int v = indices[best * 3 + c];
+            nextCache.push_back(v);
+            remaining[v]--;
+            // unlink the triangle from the vertex's list
+            unsigned int* begin = &adjacency[adjacencyOffset[v]];
+            unsigned int* end = begin + remaining[v] + 1;
+            *std::find(begin, end, (unsigned int)best) = *(end - 1);
+        }
+        for (unsigned int v : cache)
+            if (v != nextCache[0] && v != nextCache[1] && v != nextCache[2])
+                nextCache.push_back(v);
+
+        // rescore the cached and the evicted vertices and their triangles, the best of those is next
+        float bestScore = -1.0f;
+        for (size_t i = 0; i < nextCache.size(); i++)
+        {
+            unsigned int v = nextCache[i];
+            cachePosition[v] = i < (size_t)SCORED_CACHE_SIZE ? (int)i : -1;
+            score[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+        for (unsigned int v : nextCache)
+            for (unsigned int a = adjacencyOffset[v]; a < adjacencyOffset[v] + remaining[v]; a++)
+            {
+                unsigned int t = adjacency[a];
+                triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+                if (triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        if (nextCache.size() > (size_t)SCORED_CACHE_SIZE)
+            nextCache.resize(SCORED_CACHE_SIZE);
+        cache.swap(nextCache);
+
+        if (bestScore < 0.0f)
+        {
+            while (scan < triangleCount && emitted[scan])
+                scan++;
+            best = scan;
+        }
+    }
+    indices.swap(result);
+}
+
+// reorders clusters of the vertex-cache-optimized triangles so those facing outwards, likely occluders, come first.
+// clusters start where the simulated cache runs dry, so moving them costs the cache next to nothing
+inline void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions, float threshold = OVERDRAW_ACMR_THRESHOLD)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2)
+        return;
+
+    // cluster boundaries: triangles whose three vertices all miss
+    std::vector<size_t> clusterStart;
+    std::vector<size_t> loadedAt(positions.size(), 0);
+    size_t misses = 0;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        int triangleMisses = 0;
+        for (int c = 0; c < 3; c++)
+        {
+            unsigned int index = indices[t * 3 + c];
+            if (loadedAt[index] == 0 || misses + 1 - loadedAt[index] > SIMULATED_CACHE_SIZE)
+            {
+                loadedAt[index] = ++misses;
+                triangleMisses++;
+            }
+        }
+        if (t == 0 || triangleMisses == 3)
+            clusterStart.push_back(t);
+    }
+    if (clusterStart.size() < 2)
+        return;
+    clusterStart.push_back(triangleCount);
+
+    // area-weighted centroid and normal of each cluster and of the mesh
+    size_t clusterCount = clusterStart.size() - 1;
+    std::vector<glm::vec3> centroid(clusterCount, glm::vec3(0.0f)), normal(clusterCount, glm::vec3(0.0f));
+    std::vector<float> area(clusterCount, 0.0f);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++)
+        {
+            const glm::vec3& a = positions[indices[t * 3]];
+            const glm::vec3& b = positions[indices[t * 3 + 1]];
+            const glm::vec3& d = positions[indices[t * 3 + 2]];
+            glm::vec3 cross = glm::cross(b - a, d - a);
+            float triangleArea = glm::length(cross);
+            centroid[c] += (a + b + d) * (triangleArea / 3.0f);
+            normal[c] += cross;
+            area[c] += triangleArea;
+        }
+        meshCentroid += centroid[c];
+        meshArea += area[c];
+    }
+    if (meshArea <= 0.0f)
+        return;
+    meshCentroid = meshCentroid * (1.0f / meshArea);
+
+    std::vector<float> key(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        float normalLength = glm::length(normal[c]);
+        glm::vec3 clusterCentroid = area[c] > 0.0f ? centroid[c] * (1.0f / area[c]) : meshCentroid;
+        key[c] = normalLength > 0.0f ? glm::dot(clusterCentroid - meshCentroid, normal[c] * (1.0f / normalLength)) : 0.0f;
+    }
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&key](size_t a, size_t b) { return key[a] > key[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t c : order)
+        result.insert(result.end(), indices.begin() + clusterStart[c] * 3, indices.begin() + clusterStart[c + 1] * 3);
+    if (simulateVertexCache(result, positions.size()) <= threshold * misses)
+        indices.swap(result);
+}
+
+// renumbers vertices in the order the indices first use them, so vertex fetches walk the buffers forwards
+inline void optimizeVertexFetch(std::vector<glm::vec3>& positions, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    std::vector<unsigned int> remap(positions.size(), ~0u);
+    std::vector<glm::vec3> orderedPositions;
+    std::vector<Vertex> orderedVertices;
+    orderedPositions.reserve(positions.size());
+    orderedVertices.reserve(vertices.size());
+    for (unsigned int& index : indices)
+    {
+        if (remap[index] == ~0u)
+        {
+            remap[index] = (unsigned int)orderedPositions.size();
+            orderedPositions.push_back(positions[index]);
+            orderedVertices.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    positions.swap(orderedPositions);
+    vertices.swap(orderedVertices);
+}
+}
+
+// the whole pipeline on one mesh's streams: weld, vertex cache order, overdraw order, fetch order
+inline MeshOptimizationStats optimizeMesh(std::vector<glm::vec3>& positions, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    using namespace mesh_optimization;
+    MeshOptimizationStats stats;
+    stats.triangles = indices.size() / 3;
+    stats.verticesBefore = positions.size();
+    stats.missesBefore = simulateVertexCache(indices, positions.size());
+
+    weldVertices(positions, vertices, indices);
+    optimizeVertexCache(indices, positions.size());
+    optimizeOverdraw(indices, positions);
+    optimizeVertexFetch(positions, vertices, indices);
+
+    stats.verticesAfter = positions.size();
+    stats.missesAfter = simulateVertexCache(indices, positions.size());
+    return stats;
+}
+#endif
@@ -16,10 +16,18 @@ Adjusted for needs of this application
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/frustum_culling.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/gl_extensions.h>
 #include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/mesh.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/mesh_cache.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/mesh_optimizer.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/scene_bvh.h>
 #include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/shader_s.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/texture_streamer.h>
 
+#include <algorithm>
 #include <string>
+#include <chrono>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -28,7 +36,16 @@ Adjusted for needs of this application
 using namespace std;
 
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false);
+unsigned int TextureFromFile(const char* path, const string& directory, const string& type, bool gamma = false);
+
+// glMultiDrawElementsIndirect's command layout
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
 
 class Model
 {
@@ -40,40 +57,571 @@ public:
     bool gammaCorrection;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const& path, bool gamma = false) : gammaCorrection(gamma)
+    // with useCache the import is kept in a binary mesh cache next to the model (path + ".meshcache") and read from there afterwards
+    Model(string const& path, bool gamma = false, bool useCache = true) : gammaCorrection(gamma)
+    {
+        loadModel(path, useCache);
+    }
+
+    // submits each batch with one glMultiDrawElementsIndirect when the context has it, call once after loading
+    void enableMultiDrawIndirect(const GLExtensions& extensions)
+    {
+        if (!extensions.multiDrawIndirect || commands.empty())
+            return;
+        multiDrawElementsIndirect = extensions.multiDrawElementsIndirect;
+        glGenBuffers(1, &commandBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, 2 * commands.size() * sizeof(DrawElementsIndirectCommand), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        compactVisible();
+    }
+
+    // keeps only the meshes whose bounds touch the frustum of modelViewProjection for the following draws.
+    // whole subtrees of the mesh BVH are accepted or rejected at once, only the boxes of leaves crossing
+    // a plane are tested one by one
+    void cull(const glm::mat4& modelViewProjection)
+    {
+        FrustumPlanes frustum(modelViewProjection);
+        std::fill(treeVisibility.begin(), treeVisibility.end(), (unsigned char)0);
+        meshTree.cull(frustum, [&](std::uint32_t first, std::uint32_t count, bool partial) {
+            if (partial)
+                bounds.cull(frustum, first, first + count, treeVisibility.data());
+            else
+                std::fill(treeVisibility.begin() + first, treeVisibility.begin() + first + count, (unsigned char)1);
+        });
+        const vector<std::uint32_t>& treeMeshes = meshTree.items();
+        for (size_t i = 0; i < treeMeshes.size(); i++)
+            visibility[treeMeshes[i]] = treeVisibility[i];
+        compactVisible();
+    }
+
+    // from the next cull on, submits visible meshes front to back from eye (in model space): within each material
+    // batch for Draw, and all of them in one front-to-back list for DrawDepth. Otherwise they keep the batch order
+    void setDrawOrder(bool frontToBack, const glm::vec3& eye = glm::vec3(0.0f))
+    {
+        sortFrontToBack = frontToBack;
+        if (!frontToBack)
+            return;
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            glm::vec3 outside = glm::max(glm::max(meshes[i].boundsMin - eye, eye - meshes[i].boundsMax), glm::vec3(0.0f));
+            meshDistance[i] = glm::dot(outside, outside);
+        }
+    }
+
+    // draws every mesh again
+    void cullNone()
     {
-        loadModel(path);
+        std::fill(visibility.begin(), visibility.end(), (unsigned char)1);
+        compactVisible();
     }
 
-    // draws the model, and thus all its meshes
+    int visibleMeshCount() const
+    {
+        return (int)visibleCount;
+    }
+
+    // closest hit of the model-space ray origin + t * direction with the model's triangles, for t below distance.
+    // on a hit distance becomes its t and mesh the mesh hit
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float& distance, size_t& mesh)
+    {
+        std::uint32_t hitMesh = 0;
+        bool hit = meshTree.raycast(origin, direction, distance, hitMesh, [&](std::uint32_t item, float limit) {
+            std::uint32_t triangle = 0;
+            triangleTree(item).raycast(origin, direction, limit, triangle, [&](std::uint32_t t, float triangleLimit) {
+                return std::min(triangleLimit, rayTriangle(origin, direction, corner(item, t, 0), corner(item, t, 1), corner(item, t, 2)));
+            });
+            return limit;
+        });
+        if (hit)
+            mesh = hitMesh;
+        return hit;
+    }
+
+    // closest point of the model's surface to the model-space point, if nearer than distance, which becomes its distance
+    bool nearestSurface(const glm::vec3& point, float& distance, glm::vec3& closest, size_t& mesh)
+    {
+        std::uint32_t nearestMesh = 0;
+        bool found = meshTree.nearest(point, distance, nearestMesh, [&](std::uint32_t item, float limit) {
+            std::uint32_t triangle = 0;
+            triangleTree(item).nearest(point, limit, triangle, [&](std::uint32_t t, float triangleLimit) {
+                glm::vec3 candidate = closestPointOnTriangle(point, corner(item, t, 0), corner(item, t, 1), corner(item, t, 2));
+                float candidateDistance = glm::length(candidate - point);
+                if (candidateDistance >= triangleLimit)
+                    return triangleLimit;
+                // limits only shrink, so the last candidate accepted is the closest
+                closest = candidate;
+                return candidateDistance;
+            });
+            return limit;
+        });
+        if (found)
+            mesh = nearestMesh;
+        return found;
+    }
+
+    const SceneBVH& meshHierarchy() const
+    {
+        return meshTree;
+    }
+
+    // draws the model, and thus all its meshes: one multi-draw per batch of meshes sharing a material, the batches
+    // sorted by material so consecutive ones rebind only the texture units that differ
     void Draw(Shader& shader)
     {
-        for (unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+        shader.use();
+        glState().invalidateBindings();
+        glState().bindVertexArray(VAO);
+        for (const DrawBatch& batch : batches)
+        {
+            if (batch.visibleCount == 0)
+                continue;
+            meshes[batch.mesh].bindTextures(shader);
+            drawCommands(batch.visibleFirst, batch.visibleCount);
+        }
+        glState().bindVertexArray(0);
+        glState().activeTexture(0);
+    }
+
+    // draws the depth of all its meshes from the position stream alone, materials don't matter so it is a single
+    // multi-draw, front to back when setDrawOrder asked for it
+    void DrawDepth()
+    {
+        glState().invalidateBindings();
+        glState().bindVertexArray(positionVAO);
+        drawCommands(depthFirst, visibleCount);
+        glState().bindVertexArray(0);
+    }
+
+    // draw calls the last Draw issued
+    int drawCallCount() const
+    {
+        if (!multiDrawElementsIndirect)
+            return (int)visibleCount;
+        int count = 0;
+        for (const DrawBatch& batch : batches)
+            count += batch.visibleCount > 0 ? 1 : 0;
+        return count;
     }
 
 private:
+    // meshes sharing a material, their commands are consecutive
+    struct DrawBatch {
+        size_t mesh; // first mesh of the batch, whose textures it binds
+        GLsizei firstCommand;
+        GLsizei commandCount;
+        GLsizei visibleFirst; // the batch's commands that survived culling, in visibleCommands
+        GLsizei visibleCount;
+    };
+
+    // the streams of one mesh to upload, in a mapped mesh cache or the mesh's own vectors.
+    // indices are of the model's indexType
+    struct MeshSource {
+        const glm::vec3* positions;
+        const Vertex* vertices;
+        const void* indices;
+    };
+
+    // one position buffer, one attribute buffer and one index buffer for every mesh
+    unsigned int VAO = 0, positionVAO = 0;
+    unsigned int positionVBO = 0, VBO = 0, EBO = 0;
+    // GL_UNSIGNED_SHORT when every mesh has at most 65536 vertices (indices are relative to baseVertex), a multi-draw
+    // takes one index type so it is the same for the whole model
+    GLenum indexType = GL_UNSIGNED_INT;
+    vector<DrawElementsIndirectCommand> commands;
+    vector<size_t> commandMeshes; // mesh of each command
+    vector<DrawBatch> batches;
+    // BVH over the meshes' model-space bounds, bounds holds the same boxes in the tree's item order
+    SceneBVH meshTree;
+    BoundsArray bounds;
+    vector<unsigned char> treeVisibility; // in tree order
+    vector<unsigned char> visibility; // per mesh, from the last cull
+    // what the draws submit, also in commandBuffer: the visible commands batch by batch, followed by the same
+    // commands front to back for DrawDepth when sorting (depthFirst is 0 otherwise)
+    vector<DrawElementsIndirectCommand> visibleCommands;
+    GLsizei visibleCount = 0, depthFirst = 0;
+    bool sortFrontToBack = false;
+    vector<float> meshDistance; // squared distance of each mesh's bounds from the eye given to setDrawOrder
+    unsigned int commandBuffer = 0;
+    PFNMULTIDRAWELEMENTSINDIRECTPROC multiDrawElementsIndirect = nullptr;
+    // a copy of every mesh's positions and indices for the spatial queries, and a BVH over the triangles of
+    // each mesh, built by the first query reaching that mesh
+    vector<glm::vec3> queryPositions;
+    vector<unsigned int> queryIndices;
+    vector<SceneBVH> triangleTrees;
+
+    // post-processing of the Assimp import, part of the mesh cache's validity
+    static const unsigned int IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const& path)
+    void loadModel(string const& path, bool useCache)
     {
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+
+        // a cache built from this exact file skips Assimp entirely
+        string cachePath = path + ".meshcache";
+        std::uint64_t sourceSize = 0;
+        std::int64_t sourceTime = 0;
+        bool cacheable = useCache && fileStamp(path, sourceSize, sourceTime);
+        if (cacheable && loadCache(cachePath, sourceSize, sourceTime))
+        {
+            buildBatches();
+            cout << "Model loaded from mesh cache in " << chrono::duration<float, milli>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+            return;
+        }
+
         // read file via ASSIMP
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        const aiScene* scene = importer.ReadFile(path, IMPORT_FLAGS);
         // check for errors
         if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
             return;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
 
-        // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        // process ASSIMP's root node recursively, every mesh goes through the optimizer
+        MeshOptimizationStats optimization;
+        processNode(scene->mRootNode, scene, optimization);
+
+        indexType = GL_UNSIGNED_SHORT;
+        for (const Mesh& mesh : meshes)
+            if (mesh.vertexCount > 65536)
+                indexType = GL_UNSIGNED_INT;
+        vector<vector<std::uint16_t>> shortIndices(indexType == GL_UNSIGNED_SHORT ? meshes.size() : 0);
+        vector<MeshSource> sources;
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            const Mesh& mesh = meshes[i];
+            const void* indices = mesh.indices.data();
+            if (indexType == GL_UNSIGNED_SHORT)
+            {
+                for (unsigned int index : mesh.indices)
+                    shortIndices[i].push_back((std::uint16_t)index);
+                indices = shortIndices[i].data();
+            }
+            sources.push_back({ mesh.positions.data(), mesh.vertices.data(), indices });
+        }
+        uploadMeshes(sources);
+        buildBatches();
+        cout << "Model imported with Assimp in " << chrono::duration<float, milli>(chrono::steady_clock::now() - start).count() << " ms" << endl;
+        cout << "Mesh optimization: " << optimization.triangles << " triangles, vertices " << optimization.verticesBefore << " -> " << optimization.verticesAfter
+            << ", ACMR " << optimization.acmrBefore() << " -> " << optimization.acmrAfter() << ", ATVR " << optimization.atvrBefore() << " -> " << optimization.atvrAfter()
+            << ", " << (indexType == GL_UNSIGNED_SHORT ? 16 : 32) << "-bit indices" << endl;
+
+        if (cacheable && !writeMeshCache(cachePath, IMPORT_FLAGS, sourceSize, sourceTime, meshes, textures_loaded, (std::uint32_t)indexSize()))
+            cout << "Unable to write mesh cache: " << cachePath << endl;
+    }
+
+    // rebuilds the model from a mapped mesh cache, vertex and index blobs go straight from the mapping into the buffers.
+    // false, with nothing created, when the cache is missing, stale or damaged
+    bool loadCache(const string& cachePath, std::uint64_t sourceSize, std::int64_t sourceTime)
+    {
+        MappedFile file(cachePath);
+        if (!file.contains<MeshCacheHeader>(0, 1))
+            return false;
+        const char* data = file.data();
+        const MeshCacheHeader& header = *(const MeshCacheHeader*)data;
+        if (std::memcmp(header.magic, "SSMC", 4) != 0 || header.version != MESH_CACHE_VERSION || header.vertexSize != sizeof(Vertex) ||
+            header.importFlags != IMPORT_FLAGS || header.sourceSize != sourceSize || header.sourceTime != sourceTime || header.fileSize != file.size())
+            return false;
+        if (header.indexSize != sizeof(std::uint16_t) && header.indexSize != sizeof(std::uint32_t))
+            return false;
+        if (!file.contains<MeshCacheMesh>(header.meshOffset, header.meshCount) ||
+            !file.contains<MeshCacheMaterial>(header.materialOffset, header.materialCount) ||
+            !file.contains<MeshCacheMaterialTexture>(header.materialTextureOffset, header.materialTextureCount) ||
+            !file.contains<MeshCacheTexture>(header.textureOffset, header.textureCount) ||
+            !file.contains<char>(header.stringOffset, header.stringSize))
+            return false;
+        const MeshCacheMesh* meshTable = (const MeshCacheMesh*)(data + header.meshOffset);
+        const MeshCacheMaterial* materialTable = (const MeshCacheMaterial*)(data + header.materialOffset);
+        const MeshCacheMaterialTexture* materialTextures = (const MeshCacheMaterialTexture*)(data + header.materialTextureOffset);
+        const MeshCacheTexture* textureTable = (const MeshCacheTexture*)(data + header.textureOffset);
+        const char* strings = data + header.stringOffset;
+
+        // validate every table before creating anything
+        for (std::uint32_t i = 0; i < header.meshCount; i++)
+        {
+            const MeshCacheMesh& mesh = meshTable[i];
+            if (mesh.materialIndex >= header.materialCount || !file.contains<glm::vec3>(mesh.positionOffset, mesh.vertexCount) ||
+                !file.contains<Vertex>(mesh.vertexOffset, mesh.vertexCount) ||
+                !(header.indexSize == sizeof(std::uint16_t) ? file.contains<std::uint16_t>(mesh.indexOffset, mesh.indexCount) :
+                    file.contains<std::uint32_t>(mesh.indexOffset, mesh.indexCount)))
+                return false;
+            // an index past the mesh's vertices would have the GPU read another mesh's vertices or past the buffer
+            if (mesh.indexOffset % header.indexSize != 0 || !(header.indexSize == sizeof(std::uint16_t) ? indicesInRange((const std::uint16_t*)(data + mesh.indexOffset), mesh.indexCount, mesh.vertexCount) :
+                    indicesInRange((const std::uint32_t*)(data + mesh.indexOffset), mesh.indexCount, mesh.vertexCount)))
+                return false;
+        }
+        for (std::uint32_t i = 0; i < header.materialCount; i++)
+        {
+            const MeshCacheMaterial& material = materialTable[i];
+            if (material.firstTexture > header.materialTextureCount || material.textureCount > header.materialTextureCount - material.firstTexture)
+                return false;
+        }
+        for (std::uint32_t i = 0; i < header.materialTextureCount; i++)
+        {
+            const MeshCacheMaterialTexture& reference = materialTextures[i];
+            if (reference.texture >= header.textureCount || (std::uint64_t)reference.typeOffset + reference.typeLength > header.stringSize)
+                return false;
+        }
+        for (std::uint32_t i = 0; i < header.textureCount; i++)
+            if ((std::uint64_t)textureTable[i].pathOffset + textureTable[i].pathLength > header.stringSize)
+                return false;
+
+        // a texture loads as the type it is first referenced with, which picks its cooked format
+        textures_loaded.resize(header.textureCount);
+        for (std::uint32_t i = 0; i < header.materialTextureCount; i++)
+        {
+            const MeshCacheMaterialTexture& reference = materialTextures[i];
+            if (textures_loaded[reference.texture].type.empty())
+                textures_loaded[reference.texture].type = string(strings + reference.typeOffset, reference.typeLength);
+        }
+        for (std::uint32_t i = 0; i < header.textureCount; i++)
+        {
+            const MeshCacheTexture& entry = textureTable[i];
+            Texture& texture = textures_loaded[i];
+            texture.path = string(strings + entry.pathOffset, entry.pathLength);
+            texture.id = TextureFromFile(texture.path.c_str(), this->directory, texture.type);
+        }
+        vector<vector<Texture>> materials(header.materialCount);
+        for (std::uint32_t i = 0; i < header.materialCount; i++)
+            for (std::uint32_t j = 0; j < materialTable[i].textureCount; j++)
+            {
+                const MeshCacheMaterialTexture& reference = materialTextures[materialTable[i].firstTexture + j];
+                Texture texture = textures_loaded[reference.texture];
+                texture.type = string(strings + reference.typeOffset, reference.typeLength);
+                materials[i].push_back(texture);
+            }
+
+        meshes.reserve(header.meshCount);
+        vector<MeshSource> sources;
+        for (std::uint32_t i = 0; i < header.meshCount; i++)
+        {
+            const MeshCacheMesh& mesh = meshTable[i];
+            meshes.push_back(Mesh(mesh.vertexCount, mesh.indexCount, materials[mesh.materialIndex]));
+            sources.push_back({ (const glm::vec3*)(data + mesh.positionOffset), (const Vertex*)(data + mesh.vertexOffset), data + mesh.indexOffset });
+        }
+        indexType = header.indexSize == sizeof(std::uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        uploadMeshes(sources);
+        return true;
+    }
+
+    template <typename Index>
+    static bool indicesInRange(const Index* indices, std::uint32_t indexCount, std::uint32_t vertexCount)
+    {
+        for (std::uint32_t i = 0; i < indexCount; i++)
+            if (indices[i] >= vertexCount)
+                return false;
+        return true;
+    }
+
+    // packs every mesh into the model's shared buffers and records where each one landed
+    void uploadMeshes(const vector<MeshSource>& sources)
+    {
+        size_t totalVertices = 0, totalIndices = 0;
+        for (Mesh& mesh : meshes)
+        {
+            mesh.baseVertex = (int)totalVertices;
+            mesh.firstIndex = (unsigned int)totalIndices;
+            totalVertices += mesh.vertexCount;
+            totalIndices += mesh.indexCount;
+        }
+
+        // create buffers/arrays
+        glGenVertexArrays(1, &VAO);
+        glGenVertexArrays(1, &positionVAO);
+        glGenBuffers(1, &positionVBO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+
+        // load data into vertex buffers
+        glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+        glBufferData(GL_ARRAY_BUFFER, totalVertices * sizeof(glm::vec3), NULL, GL_STATIC_DRAW);
+        for (size_t i = 0; i < meshes.size(); i++)
+            glBufferSubData(GL_ARRAY_BUFFER, meshes[i].baseVertex * sizeof(glm::vec3), meshes[i].vertexCount * sizeof(glm::vec3), sources[i].positions);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, totalVertices * sizeof(Vertex), NULL, GL_STATIC_DRAW);
+        for (size_t i = 0; i < meshes.size(); i++)
+            glBufferSubData(GL_ARRAY_BUFFER, meshes[i].baseVertex * sizeof(Vertex), meshes[i].vertexCount * sizeof(Vertex), sources[i].vertices);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, totalIndices * indexSize(), NULL, GL_STATIC_DRAW);
+        for (size_t i = 0; i < meshes.size(); i++)
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, meshes[i].firstIndex * indexSize(), meshes[i].indexCount * indexSize(), sources[i].indices);
+
+        // set the vertex attribute pointers
+        // vertex Positions
+        glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        // vertex normals
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        // vertex tangent and bitangent sign
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+
+        // the depth-only array shares the position and index buffers
+        glBindVertexArray(positionVAO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // model-space bounds of every mesh and the hierarchy over them, for culling and queries
+        vector<glm::vec3> meshMin, meshMax;
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            meshes[i].computeBounds(sources[i].positions);
+            meshMin.push_back(meshes[i].boundsMin);
+            meshMax.push_back(meshes[i].boundsMax);
+        }
+        meshTree.build(meshMin, meshMax);
+        bounds.clear();
+        for (std::uint32_t mesh : meshTree.items())
+            bounds.add(meshes[mesh].boundsMin, meshes[mesh].boundsMax);
+        treeVisibility.assign(meshes.size(), 1);
+
+        queryPositions.resize(totalVertices);
+        queryIndices.resize(totalIndices);
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            std::copy(sources[i].positions, sources[i].positions + meshes[i].vertexCount, queryPositions.begin() + meshes[i].baseVertex);
+            if (indexType == GL_UNSIGNED_SHORT)
+            {
+                const std::uint16_t* indices = (const std::uint16_t*)sources[i].indices;
+                std::copy(indices, indices + meshes[i].indexCount, queryIndices.begin() + meshes[i].firstIndex);
+            }
+            else
+            {
+                const std::uint32_t* indices = (const std::uint32_t*)sources[i].indices;
+                std::copy(indices, indices + meshes[i].indexCount, queryIndices.begin() + meshes[i].firstIndex);
+            }
+        }
+        triangleTrees.assign(meshes.size(), SceneBVH());
+    }
+
+    // corner (0-2) of a mesh's triangle
+    const glm::vec3& corner(std::uint32_t mesh, std::uint32_t triangle, int index) const
+    {
+        return queryPositions[meshes[mesh].baseVertex + queryIndices[meshes[mesh].firstIndex + triangle * 3 + index]];
+    }
+
+    const SceneBVH& triangleTree(std::uint32_t mesh)
+    {
+        SceneBVH& tree = triangleTrees[mesh];
+        std::uint32_t triangleCount = meshes[mesh].indexCount / 3;
+        if (tree.items().empty() && triangleCount > 0)
+        {
+            vector<glm::vec3> triangleMin(triangleCount), triangleMax(triangleCount);
+            for (std::uint32_t t = 0; t < triangleCount; t++)
+            {
+                triangleMin[t] = glm::min(corner(mesh, t, 0), glm::min(corner(mesh, t, 1), corner(mesh, t, 2)));
+                triangleMax[t] = glm::max(corner(mesh, t, 0), glm::max(corner(mesh, t, 1), corner(mesh, t, 2)));
+            }
+            tree.build(triangleMin, triangleMax);
+        }
+        return tree;
+    }
+
+    // the render queue: meshes sorted by material (the model has one vertex array, the program is the caller's),
+    // one batch per material with one command per mesh
+    void buildBatches()
+    {
+        commands.clear();
+        commandMeshes.clear();
+        batches.clear();
+        vector<size_t> order(meshes.size());
+        for (size_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) { return meshes[a].materialBefore(meshes[b]); });
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            const Mesh& mesh = meshes[order[i]];
+            if (batches.empty() || !mesh.sameMaterial(meshes[batches.back().mesh]))
+                batches.push_back({ order[i], (GLsizei)commands.size(), 0, 0, 0 });
+            commands.push_back({ mesh.indexCount, 1, mesh.firstIndex, mesh.baseVertex, 0 });
+            commandMeshes.push_back(order[i]);
+            batches.back().commandCount++;
+        }
+        visibility.assign(meshes.size(), 1);
+        meshDistance.assign(meshes.size(), 0.0f);
+        compactVisible();
+    }
+
+    // gathers the commands of visible meshes, batch by batch, and hands them to the command buffer
+    void compactVisible()
+    {
+        auto nearer = [this](GLsizei a, GLsizei b) { return meshDistance[commandMeshes[a]] < meshDistance[commandMeshes[b]]; };
+        visibleCommands.clear();
+        vector<GLsizei> visible, batchVisible;
+        for (DrawBatch& batch : batches)
+        {
+            batchVisible.clear();
+            for (GLsizei i = batch.firstCommand; i < batch.firstCommand + batch.commandCount; i++)
+                if (visibility[commandMeshes[i]])
+                    batchVisible.push_back(i);
+            if (sortFrontToBack)
+                std::stable_sort(batchVisible.begin(), batchVisible.end(), nearer);
+            batch.visibleFirst = (GLsizei)visibleCommands.size();
+            batch.visibleCount = (GLsizei)batchVisible.size();
+            for (GLsizei i : batchVisible)
+                visibleCommands.push_back(commands[i]);
+            visible.insert(visible.end(), batchVisible.begin(), batchVisible.end());
+        }
+        visibleCount = (GLsizei)visibleCommands.size();
+        depthFirst = 0;
+        if (sortFrontToBack)
+        {
+            std::stable_sort(visible.begin(), visible.end(), nearer);
+            depthFirst = visibleCount;
+            for (GLsizei i : visible)
+                visibleCommands.push_back(commands[i]);
+        }
+        if (commandBuffer && !visibleCommands.empty())
+        {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, visibleCommands.size() * sizeof(DrawElementsIndirectCommand), visibleCommands.data());
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+    }
+
+    // issues commands [first, first + count) with the bound vertex array, in one call when multi-draw-indirect is on
+    void drawCommands(GLsizei first, GLsizei count)
+    {
+        if (count == 0)
+            return;
+        if (multiDrawElementsIndirect)
+        {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            multiDrawElementsIndirect(GL_TRIANGLES, indexType, (const void*)(first * sizeof(DrawElementsIndirectCommand)), count, 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+            return;
+        }
+        for (GLsizei i = first; i < first + count; i++)
+        {
+            const DrawElementsIndirectCommand& command = visibleCommands[i];
+            glDrawElementsBaseVertex(GL_TRIANGLES, command.count, indexType, (const void*)(command.firstIndex * indexSize()), command.baseVertex);
+        }
+    }
+
+    size_t indexSize() const
+    {
+        return indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode* node, const aiScene* scene)
+    void processNode(aiNode* node, const aiScene* scene, MeshOptimizationStats& optimization)
     {
         // process each mesh located at the current node
         for (unsigned int i = 0; i < node->mNumMeshes; i++)
@@ -81,65 +629,66 @@ private:
             // the node object only contains indices to index the actual objects in the scene. 
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            meshes.push_back(processMesh(mesh, scene, optimization));
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for (unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, optimization);
         }
 
     }
 
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene)
+    Mesh processMesh(aiMesh* mesh, const aiScene* scene, MeshOptimizationStats& optimization)
     {
         // data to fill
+        vector<glm::vec3> positions;
         vector<Vertex> vertices;
         vector<unsigned int> indices;
         vector<Texture> textures;
 
+        // texture coordinates are moved by whole units towards zero, which repeat wrapping doesn't see,
+        // so the half floats they are stored as keep their precision on heavily tiled meshes
+        glm::vec2 texCoordShift(0.0f);
+        if (mesh->mTextureCoords[0] && mesh->mNumVertices > 0)
+        {
+            glm::vec2 low(mesh->mTextureCoords[0][0].x, mesh->mTextureCoords[0][0].y), high = low;
+            for (unsigned int i = 1; i < mesh->mNumVertices; i++)
+            {
+                glm::vec2 texCoords(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+                low = glm::min(low, texCoords);
+                high = glm::max(high, texCoords);
+            }
+            texCoordShift = glm::floor((low + high) * 0.5f);
+        }
+
         // walk through each of the mesh's vertices
         for (unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
-            Vertex vertex;
             glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
             // positions
             vector.x = mesh->mVertices[i].x;
             vector.y = mesh->mVertices[i].y;
             vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
+            positions.push_back(vector);
             // normals
+            glm::vec3 normal(0.0f);
             if (mesh->HasNormals())
-            {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
-            }
+                normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
             // texture coordinates
+            glm::vec2 texCoords(0.0f, 0.0f);
+            glm::vec3 tangent(0.0f), bitangent(0.0f);
             if (mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
             {
-                glm::vec2 vec;
                 // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
                 // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x;
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
+                texCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y) - texCoordShift;
                 // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
+                tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
                 // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
+                bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
             }
-            else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-            vertices.push_back(vertex);
+            vertices.push_back(packVertex(normal, texCoords, tangent, bitangent));
         }
         // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
         for (unsigned int i = 0; i < mesh->mNumFaces; i++)
@@ -149,6 +698,8 @@ private:
             for (unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);
         }
+        // weld the duplicated corners Assimp hands out and reorder for the vertex cache, overdraw and fetches
+        optimization.add(optimizeMesh(positions, vertices, indices));
         // process materials
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -172,7 +723,7 @@ private:
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
         // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return Mesh(positions, vertices, indices, textures);
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
@@ -198,7 +749,7 @@ private:
             if (!skip)
             {   // if texture hasn't been loaded already, load it
                 Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
+                texture.id = TextureFromFile(str.C_Str(), this->directory, typeName);
                 texture.type = typeName;
                 texture.path = str.C_Str();
                 textures.push_back(texture);
@@ -210,43 +761,12 @@ private:
 };
 
 
-unsigned int TextureFromFile(const char* path, const string& directory, bool gamma)
+unsigned int TextureFromFile(const char* path, const string& directory, const string& type, bool gamma)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    // decoded on the streamer's worker threads and uploaded over the next frames, white until then
+    return textureStreamer().request(filename, type);
 }
 #endif
\ No newline at end of file
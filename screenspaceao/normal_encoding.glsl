@@ -0,0 +1,26 @@
+/*
+Octahedral normal encoding (Cigolle et al., 2014)
+http://jcgt.org/published/0003/02/01/
+Maps a unit vector onto the [0, 1]^2 square so it fits a two channel UNORM target
+*/
+
+vec2 signNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 encodeNormal(vec3 n)
+{
+    vec2 p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+    p = (n.z >= 0.0) ? p : (1.0 - abs(p.yx)) * signNotZero(p);
+    return p * 0.5 + 0.5;
+}
+
+vec3 decodeNormal(vec2 e)
+{
+    vec2 p = e * 2.0 - 1.0;
+    vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    return normalize(n);
+}
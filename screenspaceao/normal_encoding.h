@@ -0,0 +1,107 @@
+#ifndef NORMAL_ENCODING_H
+#define NORMAL_ENCODING_H
+
+/*
+G-buffer normal encodings
+Texture formats for each encoding plus a CPU mirror of normal_encoding.glsl,
+used to compare the round-trip precision of the encodings
+*/
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+enum NormalEncoding {
+    NORMAL_RGBA16F, // xyz in half floats, 8 bytes per pixel
+    NORMAL_OCT16,   // octahedral in RG16, 4 bytes per pixel
+    NORMAL_OCT8     // octahedral in RG8, 2 bytes per pixel
+};
+
+struct NormalEncodingFormat {
+    GLint internalFormat;
+    GLenum format;
+    GLenum type;
+    const char* name;
+};
+
+inline NormalEncodingFormat getNormalEncodingFormat(NormalEncoding encoding)
+{
+    switch (encoding)
+    {
+    case NORMAL_OCT16:
+        return { GL_RG16, GL_RG, GL_UNSIGNED_SHORT, "oct16" };
+    case NORMAL_OCT8:
+        return { GL_RG8, GL_RG, GL_UNSIGNED_BYTE, "oct8" };
+    default:
+        return { GL_RGBA16F, GL_RGBA, GL_FLOAT, "rgba16f" };
+    }
+}
+
+inline glm::vec2 encodeOctahedral(glm::vec3 n)
+{
+    glm::vec2 p = glm::vec2(n.x, n.y) / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+    if (n.z < 0.0f)
+    {
+        glm::vec2 s(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+        p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * s;
+    }
+    return p * 0.5f + 0.5f;
+}
+
+inline glm::vec3 decodeOctahedral(glm::vec2 e)
+{
+    glm::vec2 p = e * 2.0f - 1.0f;
+    glm::vec3 n(p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y));
+    if (n.z < 0.0f)
+    {
+        glm::vec2 s(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+        glm::vec2 xy = (1.0f - glm::abs(glm::vec2(n.y, n.x))) * s;
+        n.x = xy.x;
+        n.y = xy.y;
+    }
+    return glm::normalize(n);
+}
+
+// stores n the way the G-buffer target would and reads it back
+inline glm::vec3 roundTripNormal(NormalEncoding encoding, glm::vec3 n)
+{
+    if (encoding == NORMAL_RGBA16F)
+    {
+        glm::vec3 h(glm::unpackHalf1x16(glm::packHalf1x16(n.x)),
+            glm::unpackHalf1x16(glm::packHalf1x16(n.y)),
+            glm::unpackHalf1x16(glm::packHalf1x16(n.z)));
+        return glm::normalize(h);
+    }
+    float levels = encoding == NORMAL_OCT16 ? 65535.0f : 255.0f;
+    glm::vec2 e = glm::round(encodeOctahedral(n) * levels) / levels;
+    return decodeOctahedral(e);
+}
+
+struct NormalEncodingError {
+    float meanDegrees;
+    float maxDegrees;
+};
+
+// angular error of an encoding over sampleCount directions spread evenly over the sphere (Fibonacci lattice)
+inline NormalEncodingError measureNormalEncodingError(NormalEncoding encoding, int sampleCount = 100000)
+{
+    const float goldenAngle = 3.14159265359f * (3.0f - std::sqrt(5.0f));
+    double sum = 0.0;
+    float maxError = 0.0f;
+    for (int i = 0; i < sampleCount; i++)
+    {
+        float z = 1.0f - 2.0f * (i + 0.5f) / sampleCount;
+        float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+        glm::vec3 n(r * std::cos(goldenAngle * i), r * std::sin(goldenAngle * i), z);
+        float cosAngle = glm::clamp(glm::dot(n, roundTripNormal(encoding, n)), -1.0f, 1.0f);
+        float error = glm::degrees(std::acos(cosAngle));
+        sum += error;
+        maxError = std::max(maxError, error);
+    }
+    return { (float)(sum / sampleCount), maxError };
+}
+#endif
@@ -0,0 +1,233 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+/*
+On-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary)
+Entries are keyed by a hash of every stage's preprocessed source (so the injected defines and included
+files are part of it) and the driver's vendor, renderer and version strings, a shader edit or driver
+update simply misses. Binaries the driver rejects are deleted and the program is compiled from source
+*/
+
+#include <glad/glad.h>
+
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/gl_extensions.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+class ProgramBinaryCache
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // turns the cache on once a context exists, stays off when the context can't retrieve binaries
+    void enable(const GLExtensions& extensions, const std::string& cacheDirectory)
+    {
+        if (!extensions.programBinaries)
+            return;
+        getProgramBinary = extensions.getProgramBinary;
+        programBinary = extensions.programBinary;
+        programParameteri = extensions.programParameteri;
+
+        directory = cacheDirectory;
+        if (!directory.empty() && directory.back() != '/' && directory.back() != '\\')
+            directory += '/';
+#ifdef _WIN32
+        _mkdir(directory.c_str());
+#else
+        mkdir(directory.c_str(), 0755);
+#endif
+        driver.clear();
+        const GLenum strings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+        for (GLenum name : strings)
+        {
+            const char* value = (const char*)glGetString(name);
+            driver += value ? value : "";
+            driver += '\n';
+        }
+        enabled = true;
+    }
+
+    bool isEnabled() const
+    {
+        return enabled;
+    }
+
+    // key of a program from the preprocessed source of each of its stages, in attachment order
+    std::uint64_t key(const std::vector<std::string>& sources) const
+    {
+        std::uint64_t hash = hashBytes(driver.data(), driver.size(), 14695981039346656037ull);
+        for (const std::string& source : sources)
+        {
+            hash = hashBytes(source.data(), source.size(), hash);
+            hash = hashBytes("\0", 1, hash); // stage separator
+        }
+        return hash;
+    }
+
+    // links program from the cached binary of key, false when there is none or the driver rejects it
+    bool load(std::uint64_t key, GLuint program)
+    {
+        if (!enabled)
+            return false;
+        Clock::time_point start = Clock::now();
+        std::ifstream file(path(key), std::ios::binary);
+        if (!file.is_open())
+            return false;
+        EntryHeader header;
+        std::vector<char> binary;
+        if (file.read((char*)&header, sizeof(header)) && header.magic == ENTRY_MAGIC && header.length > 0)
+        {
+            binary.resize(header.length);
+            file.read(binary.data(), header.length);
+        }
+        bool complete = !binary.empty() && file.gcount() == header.length;
+        file.close();
+
+        GLint linked = GL_FALSE;
+        if (complete)
+        {
+            programBinary(program, header.format, binary.data(), header.length);
+            glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        }
+        if (!linked)
+        {
+            // stale or truncated, the program is rebuilt from source and stored again
+            std::remove(path(key).c_str());
+            rejectedPrograms++;
+            return false;
+        }
+        cachedPrograms++;
+        float loadMilliseconds = millisecondsSince(start);
+        cachedMilliseconds += loadMilliseconds;
+        // programs stored without a compile time count towards neither side of the saving
+        if (header.compileMilliseconds >= 0.0f)
+            savedCompileMilliseconds += header.compileMilliseconds - loadMilliseconds;
+        return true;
+    }
+
+    // asks the driver to keep program's binary retrievable, call before linking it
+    void prepare(GLuint program)
+    {
+        if (enabled)
+            programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // records a program compiled from source in compileMilliseconds, negative when the time isn't known,
+    // and writes its binary to the cache
+    void store(std::uint64_t key, GLuint program, float compileMilliseconds)
+    {
+        compiledPrograms++;
+        if (compileMilliseconds >= 0.0f)
+            compiledMilliseconds += compileMilliseconds;
+        else
+            untimedPrograms++;
+        if (!enabled)
+            return;
+        GLint linked = GL_FALSE, length = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (!linked || length <= 0)
+            return;
+
+        EntryHeader header;
+        header.compileMilliseconds = compileMilliseconds;
+        std::vector<char> binary(length);
+        GLsizei written = 0;
+        getProgramBinary(program, length, &written, &header.format, binary.data());
+        if (written <= 0)
+            return;
+        header.length = written;
+
+        std::ofstream file(path(key), std::ios::binary | std::ios::trunc);
+        file.write((const char*)&header, sizeof(header));
+        file.write(binary.data(), written);
+    }
+
+    // startup log line, how the programs were built and what the cache saved
+    std::string summary() const
+    {
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(1)
+            << "Shader programs: " << cachedPrograms + compiledPrograms << " built in " << cachedMilliseconds + compiledMilliseconds << " ms, "
+            << compiledPrograms << " compiled from source (" << compiledMilliseconds << " ms"
+            << (untimedPrograms > 0 ? ", " + std::to_string(untimedPrograms) + " untimed" : std::string()) << "), "
+            << cachedPrograms << " loaded from the binary cache (" << cachedMilliseconds << " ms)";
+        if (cachedPrograms > 0)
+            line << ", saved " << savedCompileMilliseconds << " ms of compilation";
+        if (rejectedPrograms > 0)
+            line << ", " << rejectedPrograms << " cached binaries rejected by the driver";
+        if (!enabled)
+            line << " (binary cache disabled)";
+        return line.str();
+    }
+
+private:
+    static const std::uint32_t ENTRY_MAGIC = 0x32505353; // "SSP2", entries before it may hold inflated compile times
+
+    // written in front of every cached binary
+    struct EntryHeader {
+        std::uint32_t magic = ENTRY_MAGIC;
+        GLenum format = 0;
+        GLint length = 0;
+        float compileMilliseconds = -1.0f; // what building the program from source took, reported as the saving on a hit, negative when unknown
+    };
+
+    bool enabled = false;
+    std::string directory;
+    std::string driver; // vendor, renderer and version, part of every key
+    PFNGETPROGRAMBINARYPROC getProgramBinary = nullptr;
+    PFNPROGRAMBINARYPROC programBinary = nullptr;
+    PFNPROGRAMPARAMETERIPROC programParameteri = nullptr;
+
+    int compiledPrograms = 0;
+    int untimedPrograms = 0; // compiled in the background and only found finished at first use
+    int cachedPrograms = 0;
+    int rejectedPrograms = 0;
+    float compiledMilliseconds = 0.0f;
+    float cachedMilliseconds = 0.0f;
+    float savedCompileMilliseconds = 0.0f;
+
+    std::string path(std::uint64_t key) const
+    {
+        std::ostringstream name;
+        name << directory << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+        return name.str();
+    }
+
+    // 64-bit FNV-1a, stable across runs and platforms unlike std::hash
+    static std::uint64_t hashBytes(const char* data, size_t size, std::uint64_t hash)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= (unsigned char)data[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static float millisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    }
+};
+
+// the cache every Shader is built through, off until enable is called
+inline ProgramBinaryCache& programBinaryCache()
+{
+    static ProgramBinaryCache cache;
+    return cache;
+}
+#endif
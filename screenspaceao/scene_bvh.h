@@ -0,0 +1,447 @@
+#ifndef SCENE_BVH_H
+#define SCENE_BVH_H
+
+/*
+Bounding volume hierarchy over a set of axis-aligned boxes (meshes of a model, triangles of a mesh)
+Built top-down with the surface area heuristic evaluated over 12 bins per axis, stored as a flat array of
+32-byte nodes in depth-first order: a node's children are adjacent and come after it, and the items under
+any node are one contiguous range of items(). Traversals use an explicit stack.
+Moved items are refitted bottom-up in place, the tree is rebuilt once refitting has made it noticeably
+worse than when it was built
+*/
+
+#include <glm/glm.hpp>
+
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/frustum_culling.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+class SceneBVH
+{
+public:
+    // leaves hold at most this many items, one AVX batch of BoundsArray::cull
+    static const std::uint32_t MAX_LEAF_ITEMS = 8;
+
+    struct Node {
+        glm::vec3 boundsMin;
+        std::uint32_t first; // first item of a leaf, left child of an inner node (the right one follows it)
+        glm::vec3 boundsMax;
+        std::uint32_t count; // items of a leaf, 0 for inner nodes
+
+        bool leaf() const
+        {
+            return count > 0;
+        }
+    };
+
+    // builds the tree over items 0..n-1 with the given bounds
+    void build(const std::vector<glm::vec3>& itemMin, const std::vector<glm::vec3>& itemMax)
+    {
+        boundsMin = itemMin;
+        boundsMax = itemMax;
+        rebuild();
+    }
+
+    // moves an item, the tree is only updated by refit()
+    void updateItem(std::uint32_t item, const glm::vec3& itemMin, const glm::vec3& itemMax)
+    {
+        boundsMin[item] = itemMin;
+        boundsMax[item] = itemMax;
+    }
+
+    // updates every node's bounds after updateItem, rebuilding instead when the tree got too loose.
+    // true when it rebuilt
+    bool refit()
+    {
+        // children come after their parent, so walking backwards sees them first
+        for (size_t i = nodes.size(); i-- > 0;)
+        {
+            Node& node = nodes[i];
+            if (node.leaf())
+            {
+                node.boundsMin = boundsMin[order[node.first]];
+                node.boundsMax = boundsMax[order[node.first]];
+                for (std::uint32_t j = node.first + 1; j < node.first + node.count; j++)
+                {
+                    node.boundsMin = glm::min(node.boundsMin, boundsMin[order[j]]);
+                    node.boundsMax = glm::max(node.boundsMax, boundsMax[order[j]]);
+                }
+            }
+            else
+            {
+                node.boundsMin = glm::min(nodes[node.first].boundsMin, nodes[node.first + 1].boundsMin);
+                node.boundsMax = glm::max(nodes[node.first].boundsMax, nodes[node.first + 1].boundsMax);
+            }
+        }
+        if (nodes.empty() || cost() <= builtCost * REBUILD_RATIO)
+            return false;
+        rebuild();
+        return true;
+    }
+
+    // the items in leaf order, a leaf's items are items()[first, first + count)
+    const std::vector<std::uint32_t>& items() const
+    {
+        return order;
+    }
+
+    const std::vector<Node>& nodeArray() const
+    {
+        return nodes;
+    }
+
+    // expected traversal cost relative to the root's area, the quantity the build minimises
+    float cost() const
+    {
+        if (nodes.empty())
+            return 0.0f;
+        float total = 0.0f;
+        for (const Node& node : nodes)
+            total += area(node.boundsMin, node.boundsMax) * (node.leaf() ? (float)node.count : TRAVERSAL_COST);
+        float rootArea = area(nodes[0].boundsMin, nodes[0].boundsMax);
+        return rootArea > 0.0f ? total / rootArea : 0.0f;
+    }
+
+    // calls visit(first, count, partial) for the ranges of items() not outside the frustum.
+    // partial when the range's node crosses a plane, so its items still need testing
+    template <typename VisitRange>
+    void cull(const FrustumPlanes& frustum, VisitRange&& visit) const
+    {
+        if (nodes.empty())
+            return;
+        std::vector<std::uint32_t> stack(1, 0);
+        while (!stack.empty())
+        {
+            std::uint32_t index = stack.back();
+            stack.pop_back();
+            const Node& node = nodes[index];
+            int side = frustum.classify(node.boundsMin, node.boundsMax);
+            if (side < 0)
+                continue;
+            if (side > 0 || node.leaf())
+            {
+                std::uint32_t first, count;
+                itemRange(index, first, count);
+                visit(first, count, side == 0);
+                continue;
+            }
+            stack.push_back(node.first + 1);
+            stack.push_back(node.first);
+        }
+    }
+
+    // closest hit of the ray origin + t * direction with t in [0, distance): intersect(item, distance) returns
+    // the item's hit closer than distance or distance itself. Shortens distance and sets item on a hit
+    template <typename IntersectItem>
+    bool raycast(const glm::vec3& origin, const glm::vec3& direction, float& distance, std::uint32_t& item, IntersectItem&& intersect) const
+    {
+        if (nodes.empty())
+            return false;
+        glm::vec3 inverse = 1.0f / direction;
+        bool hit = false;
+        std::vector<std::pair<std::uint32_t, float>> stack(1, std::make_pair(0u, slabEntry(nodes[0], origin, inverse, distance)));
+        while (!stack.empty())
+        {
+            std::pair<std::uint32_t, float> entry = stack.back();
+            stack.pop_back();
+            if (entry.second >= distance)
+                continue;
+            const Node& node = nodes[entry.first];
+            if (node.leaf())
+            {
+                for (std::uint32_t i = node.first; i < node.first + node.count; i++)
+                {
+                    float itemDistance = intersect(order[i], distance);
+                    if (itemDistance < distance)
+                    {
+                        distance = itemDistance;
+                        item = order[i];
+                        hit = true;
+                    }
+                }
+                continue;
+            }
+            // the nearer child is visited first, so hits in it cut off the farther one
+            float left = slabEntry(nodes[node.first], origin, inverse, distance);
+            float right = slabEntry(nodes[node.first + 1], origin, inverse, distance);
+            std::pair<std::uint32_t, float> nearer(node.first, left), farther(node.first + 1, right);
+            if (right < left)
+                std::swap(nearer, farther);
+            if (farther.second < distance)
+                stack.push_back(farther);
+            if (nearer.second < distance)
+                stack.push_back(nearer);
+        }
+        return hit;
+    }
+
+    // closest item to point within distance: measure(item, distance) returns the item's distance to point when
+    // below distance, or distance itself. Shortens distance and sets item when one is found
+    template <typename MeasureItem>
+    bool nearest(const glm::vec3& point, float& distance, std::uint32_t& item, MeasureItem&& measure) const
+    {
+        if (nodes.empty())
+            return false;
+        bool found = false;
+        std::vector<std::pair<std::uint32_t, float>> stack(1, std::make_pair(0u, boxDistance(nodes[0], point)));
+        while (!stack.empty())
+        {
+            std::pair<std::uint32_t, float> entry = stack.back();
+            stack.pop_back();
+            if (entry.second >= distance)
+                continue;
+            const Node& node = nodes[entry.first];
+            if (node.leaf())
+            {
+                for (std::uint32_t i = node.first; i < node.first + node.count; i++)
+                {
+                    if (boxDistance(boundsMin[order[i]], boundsMax[order[i]], point) >= distance)
+                        continue;
+                    float itemDistance = measure(order[i], distance);
+                    if (itemDistance < distance)
+                    {
+                        distance = itemDistance;
+                        item = order[i];
+                        found = true;
+                    }
+                }
+                continue;
+            }
+            std::pair<std::uint32_t, float> nearer(node.first, boxDistance(nodes[node.first], point));
+            std::pair<std::uint32_t, float> farther(node.first + 1, boxDistance(nodes[node.first + 1], point));
+            if (farther.second < nearer.second)
+                std::swap(nearer, farther);
+            if (farther.second < distance)
+                stack.push_back(farther);
+            if (nearer.second < distance)
+                stack.push_back(nearer);
+        }
+        return found;
+    }
+
+private:
+    static const int BIN_COUNT = 12;
+    // cost of visiting an inner node relative to testing one item
+    static constexpr float TRAVERSAL_COST = 1.0f;
+    // refitting may make the tree this much more expensive before it is rebuilt
+    static constexpr float REBUILD_RATIO = 1.5f;
+
+    std::vector<Node> nodes;
+    std::vector<std::uint32_t> order;
+    std::vector<glm::vec3> boundsMin, boundsMax; // per item, in item order
+    float builtCost = 0.0f;
+
+    struct Bin {
+        glm::vec3 boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+        std::uint32_t count = 0;
+
+        void grow(const glm::vec3& low, const glm::vec3& high)
+        {
+            boundsMin = glm::min(boundsMin, low);
+            boundsMax = glm::max(boundsMax, high);
+        }
+    };
+
+    static float area(const glm::vec3& low, const glm::vec3& high)
+    {
+        glm::vec3 size = glm::max(high - low, glm::vec3(0.0f));
+        return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+    }
+
+    // distance along the ray to where it enters node, infinity when it misses it before limit
+    static float slabEntry(const Node& node, const glm::vec3& origin, const glm::vec3& inverse, float limit)
+    {
+        glm::vec3 t0 = (node.boundsMin - origin) * inverse, t1 = (node.boundsMax - origin) * inverse;
+        glm::vec3 nearer = glm::min(t0, t1), farther = glm::max(t0, t1);
+        float enter = std::max(std::max(nearer.x, nearer.y), std::max(nearer.z, 0.0f));
+        float exit = std::min(std::min(farther.x, farther.y), std::min(farther.z, limit));
+        return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+    }
+
+    static float boxDistance(const glm::vec3& low, const glm::vec3& high, const glm::vec3& point)
+    {
+        return glm::length(glm::max(glm::max(low - point, point - high), glm::vec3(0.0f)));
+    }
+
+    static float boxDistance(const Node& node, const glm::vec3& point)
+    {
+        return boxDistance(node.boundsMin, node.boundsMax, point);
+    }
+
+    // the range of items() under a node: from its leftmost leaf to the end of its rightmost one
+    void itemRange(std::uint32_t index, std::uint32_t& first, std::uint32_t& count) const
+    {
+        std::uint32_t left = index, right = index;
+        while (!nodes[left].leaf())
+            left = nodes[left].first;
+        while (!nodes[right].leaf())
+            right = nodes[right].first + 1;
+        first = nodes[left].first;
+        count = nodes[right].first + nodes[right].count - first;
+    }
+
+    void rebuild()
+    {
+        std::uint32_t itemCount = (std::uint32_t)boundsMin.size();
+        nodes.clear();
+        order.resize(itemCount);
+        for (std::uint32_t i = 0; i < itemCount; i++)
+            order[i] = i;
+        builtCost = 0.0f;
+        if (itemCount == 0)
+            return;
+        nodes.reserve(2 * itemCount);
+        nodes.push_back(Node());
+        subdivide(0, 0, itemCount);
+        builtCost = cost();
+    }
+
+    glm::vec3 centroid(std::uint32_t item) const
+    {
+        return (boundsMin[item] + boundsMax[item]) * 0.5f;
+    }
+
+    // turns nodes[index] into the subtree over order[first, first + count)
+    void subdivide(std::uint32_t index, std::uint32_t first, std::uint32_t count)
+    {
+        Bin all, centroids;
+        for (std::uint32_t i = first; i < first + count; i++)
+        {
+            all.grow(boundsMin[order[i]], boundsMax[order[i]]);
+            centroids.grow(centroid(order[i]), centroid(order[i]));
+        }
+        nodes[index] = { all.boundsMin, first, all.boundsMax, count };
+        if (count == 1)
+            return;
+
+        // cheapest bin boundary over all axes, in units of area times items
+        int bestAxis = -1, bestSplit = 0;
+        float bestCost = std::numeric_limits<float>::max();
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float low = centroids.boundsMin[axis], extent = centroids.boundsMax[axis] - low;
+            if (extent <= 0.0f)
+                continue;
+            Bin bins[BIN_COUNT];
+            float scale = BIN_COUNT / extent;
+            for (std::uint32_t i = first; i < first + count; i++)
+            {
+                Bin& bin = bins[binOf(centroid(order[i])[axis], low, scale)];
+                bin.grow(boundsMin[order[i]], boundsMax[order[i]]);
+                bin.count++;
+            }
+            // sweep from the right to get the cost of every right side, then from the left
+            float rightCost[BIN_COUNT];
+            Bin right;
+            for (int b = BIN_COUNT - 1; b > 0; b--)
+            {
+                right.grow(bins[b].boundsMin, bins[b].boundsMax);
+                right.count += bins[b].count;
+                rightCost[b] = right.count > 0 ? area(right.boundsMin, right.boundsMax) * right.count : 0.0f;
+            }
+            Bin left;
+            for (int b = 0; b < BIN_COUNT - 1; b++)
+            {
+                left.grow(bins[b].boundsMin, bins[b].boundsMax);
+                left.count += bins[b].count;
+                if (left.count == 0 || left.count == count)
+                    continue;
+                float splitCost = area(left.boundsMin, left.boundsMax) * left.count + rightCost[b + 1];
+                if (splitCost < bestCost)
+                {
+                    bestCost = splitCost;
+                    bestAxis = axis;
+                    bestSplit = b + 1;
+                }
+            }
+        }
+
+        float leafCost = area(all.boundsMin, all.boundsMax) * count;
+        if (count <= MAX_LEAF_ITEMS && (bestAxis < 0 || bestCost + TRAVERSAL_COST * area(all.boundsMin, all.boundsMax) >= leafCost))
+            return;
+
+        std::uint32_t* begin = order.data() + first;
+        std::uint32_t* middle;
+        if (bestAxis >= 0)
+        {
+            float low = centroids.boundsMin[bestAxis], scale = BIN_COUNT / (centroids.boundsMax[bestAxis] - low);
+            middle = std::partition(begin, begin + count,
+                [&](std::uint32_t item) { return binOf(centroid(item)[bestAxis], low, scale) < bestSplit; });
+        }
+        else
+        {
+            // coincident centroids, too many for one leaf: halve by order
+            middle = begin + count / 2;
+        }
+        std::uint32_t leftCount = (std::uint32_t)(middle - begin);
+
+        std::uint32_t left = (std::uint32_t)nodes.size();
+        nodes.push_back(Node());
+        nodes.push_back(Node());
+        nodes[index].first = left;
+        nodes[index].count = 0;
+        subdivide(left, first, leftCount);
+        subdivide(left + 1, first + leftCount, count - leftCount);
+    }
+
+    static int binOf(float value, float low, float scale)
+    {
+        return std::min(BIN_COUNT - 1, std::max(0, (int)((value - low) * scale)));
+    }
+};
+
+// distance along origin + t * direction to triangle abc, infinity when it misses (Moller and Trumbore)
+inline float rayTriangle(const glm::vec3& origin, const glm::vec3& direction, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    const float miss = std::numeric_limits<float>::infinity();
+    glm::vec3 edge1 = b - a, edge2 = c - a;
+    glm::vec3 p = glm::cross(direction, edge2);
+    float determinant = glm::dot(edge1, p);
+    if (std::fabs(determinant) < 1e-12f)
+        return miss;
+    float inverse = 1.0f / determinant;
+    glm::vec3 s = origin - a;
+    float u = glm::dot(s, p) * inverse;
+    if (u < 0.0f || u > 1.0f)
+        return miss;
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(direction, q) * inverse;
+    if (v < 0.0f || u + v > 1.0f)
+        return miss;
+    float t = glm::dot(edge2, q) * inverse;
+    return t >= 0.0f ? t : miss;
+}
+
+// closest point of triangle abc to p (Ericson, Real-Time Collision Detection 5.1.5)
+inline glm::vec3 closestPointOnTriangle(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    glm::vec3 ab = b - a, ac = c - a, ap = p - a;
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f)
+        return a;
+    glm::vec3 bp = p - b;
+    float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3)
+        return b;
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        return a + ab * (d1 / (d1 - d3));
+    glm::vec3 cp = p - c;
+    float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6)
+        return c;
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        return a + ac * (d2 / (d2 - d6));
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+        return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    float denominator = 1.0f / (va + vb + vc);
+    return a + ab * (vb * denominator) + ac * (vc * denominator);
+}
+#endif
@@ -0,0 +1,187 @@
+#ifndef SHADER_REGISTRY_H
+#define SHADER_REGISTRY_H
+
+/*
+Owner of every program the renderer uses
+Programs requested with the same stage files and defines are shared (e.g. the blur of all three
+techniques) and built on first use. When the driver exposes GL_KHR_parallel_shader_compile all of
+them are instead issued up front and finished by poll() as their background compiles complete,
+so only the programs the first frame needs are waited on and later toggles don't hitch
+ShaderPermutations picks compile-time specialized variants of one program out of the registry
+*/
+
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/shader_s.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/gl_extensions.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ShaderRegistry
+{
+public:
+    // hands compiling to the driver's background threads if it can, call before requesting programs
+    void enableParallelCompile(const GLExtensions& extensions)
+    {
+        if (!extensions.parallelShaderCompile)
+            return;
+        extensions.maxShaderCompilerThreads(0xFFFFFFFF); // as many threads as the driver likes
+        parallel = true;
+    }
+
+    bool parallelCompile() const
+    {
+        return parallel;
+    }
+
+    // program from a vertex and fragment shader, shared with every earlier request for the same files and defines
+    Shader& get(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines = std::vector<std::string>())
+    {
+        std::string key = programKey(vertexPath, fragmentPath, defines);
+        auto found = programs.find(key);
+        if (found != programs.end())
+            return *found->second;
+        return add(key, std::unique_ptr<Shader>(new Shader(vertexPath, fragmentPath, defines, nullptr, true)));
+    }
+
+    // compute program, shared the same way
+    Shader& getCompute(const char* computePath, const std::vector<std::string>& defines)
+    {
+        std::string key = programKey(computePath, "", defines);
+        auto found = programs.find(key);
+        if (found != programs.end())
+            return *found->second;
+        return add(key, std::unique_ptr<Shader>(new Shader(computePath, defines, true)));
+    }
+
+    // finishes the programs whose background compile completed, call once per frame
+    // returns true when this call linked the last outstanding program
+    bool poll()
+    {
+        if (!parallel || pending == 0)
+            return false;
+        for (auto& program : programs)
+        {
+            Shader& shader = *program.second;
+            if (!shader.isLinked() && shader.buildCompleted())
+                shader.build();
+        }
+        int wasPending = pending;
+        pending = countPending();
+        return wasPending > 0 && pending == 0;
+    }
+
+    // links every program now, e.g. so none is built inside a measured frame
+    void buildAll()
+    {
+        for (auto& program : programs)
+            program.second->build();
+        pending = 0;
+    }
+
+    int programCount() const
+    {
+        return (int)programs.size();
+    }
+
+    int linkedCount() const
+    {
+        return programCount() - countPending();
+    }
+
+private:
+    std::map<std::string, std::unique_ptr<Shader>> programs; // unique_ptr so references stay valid
+    bool parallel = false;
+    int pending = 0;
+
+    Shader& add(const std::string& key, std::unique_ptr<Shader> shader)
+    {
+        Shader& added = *shader;
+        programs[key] = std::move(shader);
+        if (parallel)
+        {
+            added.startBuild();
+            pending = countPending();
+        }
+        return added;
+    }
+
+    int countPending() const
+    {
+        int count = 0;
+        for (const auto& program : programs)
+            count += program.second->isLinked() ? 0 : 1;
+        return count;
+    }
+
+    static std::string programKey(const char* firstPath, const char* secondPath, const std::vector<std::string>& defines)
+    {
+        std::string key = std::string(firstPath) + "|" + secondPath;
+        for (const std::string& define : defines)
+            key += "|" + define;
+        return key;
+    }
+};
+
+// variants of one program that differ only in integer #defines such as KERNEL_SIZE (see ssao.glsl),
+// each variant comes from the registry the first time its values are asked for and is found by them afterwards
+class ShaderPermutations
+{
+public:
+    // vertex/fragment program
+    ShaderPermutations(ShaderRegistry& registry, const char* vertexPath, const char* fragmentPath,
+        const std::vector<std::string>& defines, const std::vector<std::string>& parameters)
+        : registry(registry), firstPath(vertexPath), secondPath(fragmentPath), defines(defines), parameters(parameters)
+    {
+    }
+    // compute program
+    ShaderPermutations(ShaderRegistry& registry, const char* computePath,
+        const std::vector<std::string>& defines, const std::vector<std::string>& parameters)
+        : registry(registry), firstPath(computePath), secondPath(nullptr), defines(defines), parameters(parameters)
+    {
+    }
+
+    // the variant with one value per parameter, in the order the parameters were given
+    Shader& get(const std::vector<int>& values)
+    {
+        auto found = variants.find(values);
+        if (found != variants.end())
+            return *found->second;
+        std::vector<std::string> variantDefines = defines;
+        for (size_t i = 0; i < parameters.size() && i < values.size(); i++)
+            variantDefines.push_back(parameters[i] + " " + std::to_string(values[i]));
+        Shader& variant = secondPath ? registry.get(firstPath, secondPath, variantDefines) : registry.getCompute(firstPath, variantDefines);
+        for (const auto& sampler : samplerUnits)
+            variant.setSampler(sampler.first, sampler.second);
+        variants[values] = &variant;
+        return variant;
+    }
+
+    // assigns a sampler to a texture unit in every variant, present and future
+    void setSampler(const std::string& name, int unit)
+    {
+        samplerUnits.push_back({ name, unit });
+        for (auto& variant : variants)
+            variant.second->setSampler(name, unit);
+    }
+
+    // e.g. "KERNEL_SIZE=16 K=1", names the variant in the benchmark report
+    std::string label(const std::vector<int>& values) const
+    {
+        std::string text;
+        for (size_t i = 0; i < parameters.size() && i < values.size(); i++)
+            text += (i > 0 ? " " : "") + parameters[i] + "=" + std::to_string(values[i]);
+        return text;
+    }
+
+private:
+    ShaderRegistry& registry;
+    const char* firstPath;
+    const char* secondPath; // nullptr for a compute program
+    std::vector<std::string> defines;
+    std::vector<std::string> parameters;
+    std::map<std::vector<int>, Shader*> variants;
+    std::vector<std::pair<std::string, int>> samplerUnits;
+};
+#endif
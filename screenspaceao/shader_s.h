@@ -10,18 +10,52 @@ Adjusted for needs of this application
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/gl_extensions.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/gl_state.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/uniform_buffers.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/program_cache.h>
+
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <functional>
+#include <utility>
+
+// glUniform* for each uniform type, the currently bound program is the one set
+// ------------------------------------------------------------------------
+inline void setUniform(GLint location, bool value) { glUniform1i(location, (int)value); }
+inline void setUniform(GLint location, int value) { glUniform1i(location, value); }
+inline void setUniform(GLint location, float value) { glUniform1f(location, value); }
+inline void setUniform(GLint location, const glm::vec2& value) { glUniform2fv(location, 1, &value[0]); }
+inline void setUniform(GLint location, const glm::vec3& value) { glUniform3fv(location, 1, &value[0]); }
+inline void setUniform(GLint location, const glm::vec4& value) { glUniform4fv(location, 1, &value[0]); }
+inline void setUniform(GLint location, const glm::mat2& mat) { glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]); }
+inline void setUniform(GLint location, const glm::mat3& mat) { glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]); }
+inline void setUniform(GLint location, const glm::mat4& mat) { glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]); }
+
+// uniform location resolved once by Shader::uniform, typed so it can only be set with the uniform's type
+template <typename T>
+struct UniformHandle {
+    GLint location = -1;
+    void set(const T& value) const { setUniform(location, value); }
+};
 
 class Shader
 {
 public:
-    unsigned int ID;
+    unsigned int ID = 0;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+        : Shader(vertexPath, fragmentPath, std::vector<std::string>(), geometryPath)
+    {
+    }
+    // same as above, with each entry of defines (e.g. "KERNEL_SIZE 16") injected as a #define after the #version line,
+    // deferred leaves compiling to startBuild/build, which use() calls on first use
+    // ------------------------------------------------------------------------
+    Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines, const char* geometryPath = nullptr, bool deferred = false)
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -47,8 +81,8 @@ public:
             vShaderFile.close();
             fShaderFile.close();
             // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+            vertexCode = preprocess(vShaderStream.str(), vertexPath, defines);
+            fragmentCode = preprocess(fShaderStream.str(), fragmentPath, defines);
             // if geometry shader path is present, also load a geometry shader
             if (geometryPath != nullptr)
             {
@@ -56,118 +90,362 @@ public:
                 std::stringstream gShaderStream;
                 gShaderStream << gShaderFile.rdbuf();
                 gShaderFile.close();
-                geometryCode = gShaderStream.str();
+                geometryCode = preprocess(gShaderStream.str(), geometryPath, defines);
             }
         }
         catch (std::ifstream::failure& e)
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
+        stages.push_back({ GL_VERTEX_SHADER, vertexCode });
+        stages.push_back({ GL_FRAGMENT_SHADER, fragmentCode });
         if (geometryPath != nullptr)
+            stages.push_back({ GL_GEOMETRY_SHADER, geometryCode });
+        // 2. compile and link, unless the caller starts and finishes that itself (see ShaderRegistry)
+        if (!deferred)
+            build();
+    }
+    // compute shader program, defines are injected the same way (needs a GL 4.3 context)
+    // ------------------------------------------------------------------------
+    Shader(const char* computePath, const std::vector<std::string>& defines, bool deferred = false)
+    {
+        std::string computeCode;
+        std::ifstream cShaderFile;
+        cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+        try
         {
-            const char* gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
+            cShaderFile.open(computePath);
+            std::stringstream cShaderStream;
+            cShaderStream << cShaderFile.rdbuf();
+            cShaderFile.close();
+            computeCode = preprocess(cShaderStream.str(), computePath, defines);
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
         }
-        // shader Program
+        stages.push_back({ GL_COMPUTE_SHADER, computeCode });
+        if (!deferred)
+            build();
+    }
+    // issues the compiles and the link without waiting for them, a program found in the binary cache is linked straight away
+    // with GL_KHR_parallel_shader_compile the driver then works on it in the background
+    // ------------------------------------------------------------------------
+    void startBuild()
+    {
+        if (state != NOT_STARTED)
+            return;
+        ProgramBinaryCache& cache = programBinaryCache();
+        std::vector<std::string> sources;
+        for (const auto& stage : stages)
+            sources.push_back(stage.second);
+        cacheKey = cache.key(sources);
         ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if (geometryPath != nullptr)
-            glAttachShader(ID, geometry);
+        if (cache.load(cacheKey, ID))
+        {
+            finishLinked();
+            return;
+        }
+        buildStart = ProgramBinaryCache::Clock::now();
+        for (const auto& stage : stages)
+        {
+            const char* code = stage.second.c_str();
+            unsigned int shader = glCreateShader(stage.first);
+            glShaderSource(shader, 1, &code, NULL);
+            glCompileShader(shader);
+            glAttachShader(ID, shader);
+            stageShaders.push_back(shader);
+        }
+        cache.prepare(ID);
         glLinkProgram(ID);
+        state = LINKING;
+    }
+    // true once the driver finished the background compile and link (GL_COMPLETION_STATUS_KHR),
+    // only meaningful when the context exposes GL_KHR_parallel_shader_compile
+    // ------------------------------------------------------------------------
+    bool buildCompleted() const
+    {
+        if (state != LINKING)
+            return state == LINKED;
+        GLint completed = GL_FALSE;
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &completed);
+        // the first report of completion ends the compile time the binary cache records
+        if (completed == GL_TRUE && !buildEndSeen)
+        {
+            buildEnd = ProgramBinaryCache::Clock::now();
+            buildEndSeen = true;
+        }
+        return completed == GL_TRUE;
+    }
+    // makes sure the program is linked, blocking on whatever compile is still outstanding
+    // ------------------------------------------------------------------------
+    void build()
+    {
+        bool issuedHere = state == NOT_STARTED;
+        startBuild();
+        if (state != LINKING)
+            return;
+        // report errors in the same order a synchronous build would
+        static const struct { GLenum stage; const char* name; } stageNames[] = {
+            { GL_VERTEX_SHADER, "VERTEX" }, { GL_FRAGMENT_SHADER, "FRAGMENT" },
+            { GL_GEOMETRY_SHADER, "GEOMETRY" }, { GL_COMPUTE_SHADER, "COMPUTE" },
+        };
+        for (size_t i = 0; i < stageShaders.size(); i++)
+            for (const auto& stageName : stageNames)
+                if (stageName.stage == stages[i].first)
+                    checkCompileErrors(stageShaders[i], stageName.name);
         checkCompileErrors(ID, "PROGRAM");
+        // a build issued here blocked on the compile just now; one issued earlier is timed up to when buildCompleted
+        // first saw it done, and has no known time when its first use came before that (the gap may include loading)
+        float compileMilliseconds = -1.0f;
+        if (issuedHere)
+            compileMilliseconds = std::chrono::duration<float, std::milli>(ProgramBinaryCache::Clock::now() - buildStart).count();
+        else if (buildEndSeen)
+            compileMilliseconds = std::chrono::duration<float, std::milli>(buildEnd - buildStart).count();
+        programBinaryCache().store(cacheKey, ID, compileMilliseconds);
         // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if (geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+        for (unsigned int shader : stageShaders)
+            glDeleteShader(shader);
+        stageShaders.clear();
+        finishLinked();
+    }
+    bool isLinked() const
+    {
+        return state == LINKED;
     }
-    // activate the shader
+    // assigns a sampler uniform to a texture unit, programs that aren't linked yet apply it once they are
+    // ------------------------------------------------------------------------
+    void setSampler(const std::string& name, int unit)
+    {
+        samplerUnits.push_back({ name, unit });
+        if (state == LINKED)
+            applySamplerUnits();
+    }
+    // activate the shader, linking it first if it was deferred
     // ------------------------------------------------------------------------
     void use()
     {
-        glUseProgram(ID);
+        build();
+        glState().useProgram(ID);
     }
-    // utility uniform functions
+    // utility uniform functions, locations come from the table built after linking
     // ------------------------------------------------------------------------
     void setBool(const std::string& name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        setUniform(location(name), value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string& name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        setUniform(location(name), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string& name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        setUniform(location(name), value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string& name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setUniform(location(name), value);
     }
     void setVec2(const std::string& name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        setUniform(location(name), glm::vec2(x, y));
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string& name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setUniform(location(name), value);
     }
     void setVec3(const std::string& name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        setUniform(location(name), glm::vec3(x, y, z));
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string& name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setUniform(location(name), value);
     }
-    void setVec4(const std::string& name, float x, float y, float z, float w)
+    void setVec4(const std::string& name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        setUniform(location(name), glm::vec4(x, y, z, w));
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string& name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setUniform(location(name), mat);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string& name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setUniform(location(name), mat);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string& name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setUniform(location(name), mat);
+    }
+    // pre-resolved handle for a uniform set on a hot path, e.g. once per draw
+    // ------------------------------------------------------------------------
+    template <typename T>
+    UniformHandle<T> uniform(const std::string& name) const
+    {
+        UniformHandle<T> handle;
+        handle.location = location(name);
+        return handle;
+    }
+    // location of an active uniform, -1 (ignored by glUniform*) when the program doesn't use it
+    // array uniforms are found both by their name and by name[i]
+    // ------------------------------------------------------------------------
+    GLint location(const std::string& name) const
+    {
+        if (uniformTable.empty())
+            return -1;
+        size_t mask = uniformTable.size() - 1;
+        for (size_t slot = std::hash<std::string>()(name) & mask; ; slot = (slot + 1) & mask)
+        {
+            const UniformSlot& entry = uniformTable[slot];
+            if (entry.location < 0)
+                return -1;
+            if (entry.name == name)
+                return entry.location;
+        }
     }
 
 private:
+    // open addressing table of the program's active uniforms, linear probing, at most half full
+    struct UniformSlot {
+        std::string name;
+        GLint location = -1;
+    };
+    std::vector<UniformSlot> uniformTable;
+
+    // build state, the preprocessed stage sources are kept until the program is linked
+    enum BuildState { NOT_STARTED, LINKING, LINKED };
+    BuildState state = NOT_STARTED;
+    std::vector<std::pair<GLenum, std::string>> stages;
+    std::vector<unsigned int> stageShaders;
+    std::uint64_t cacheKey = 0;
+    ProgramBinaryCache::Clock::time_point buildStart;
+    mutable ProgramBinaryCache::Clock::time_point buildEnd;
+    mutable bool buildEndSeen = false;
+    std::vector<std::pair<std::string, int>> samplerUnits;
+
+    // everything that needs the linked program: block bindings, the uniform table and the sampler units
+    // ------------------------------------------------------------------------
+    void finishLinked()
+    {
+        bindUniformBlocks(ID);
+        cacheUniforms();
+        state = LINKED;
+        stages.clear();
+        applySamplerUnits();
+    }
+
+    void applySamplerUnits()
+    {
+        if (samplerUnits.empty())
+            return;
+        GLint previous = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+        glUseProgram(ID);
+        for (const auto& sampler : samplerUnits)
+            setUniform(location(sampler.first), sampler.second);
+        glUseProgram(previous);
+    }
+
+    // introspects the active uniforms once after linking, members of uniform blocks have no location and are left out
+    // ------------------------------------------------------------------------
+    void cacheUniforms()
+    {
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<std::pair<std::string, GLint>> uniforms;
+        std::vector<GLchar> nameBuffer(maxLength > 0 ? maxLength : 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLint size = 0;
+            GLenum type = 0;
+            GLsizei length = 0;
+            glGetActiveUniform(ID, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+            std::string name(nameBuffer.data(), length);
+            GLint uniformLocation = glGetUniformLocation(ID, name.c_str());
+            if (uniformLocation < 0)
+                continue;
+            uniforms.push_back({ name, uniformLocation });
+            // arrays are reported as name[0], register the bare name and every other element too
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+            {
+                std::string base = name.substr(0, name.size() - 3);
+                uniforms.push_back({ base, uniformLocation });
+                for (GLint element = 1; element < size; element++)
+                {
+                    std::string elementName = base + "[" + std::to_string(element) + "]";
+                    GLint elementLocation = glGetUniformLocation(ID, elementName.c_str());
+                    if (elementLocation >= 0)
+                        uniforms.push_back({ elementName, elementLocation });
+                }
+            }
+        }
+
+        size_t capacity = 8;
+        while (capacity < uniforms.size() * 2)
+            capacity *= 2;
+        uniformTable.assign(capacity, UniformSlot());
+        size_t mask = capacity - 1;
+        for (const auto& uniform : uniforms)
+        {
+            size_t slot = std::hash<std::string>()(uniform.first) & mask;
+            while (uniformTable[slot].location >= 0 && uniformTable[slot].name != uniform.first)
+                slot = (slot + 1) & mask;
+            uniformTable[slot].name = uniform.first;
+            uniformTable[slot].location = uniform.second;
+        }
+    }
+
+    // resolves #include "file" lines (relative to the including file) and injects the defines after #version
+    // ------------------------------------------------------------------------
+    static std::string preprocess(const std::string& source, const std::string& path, const std::vector<std::string>& defines)
+    {
+        std::string directory;
+        size_t slash = path.find_last_of("/\\");
+        if (slash != std::string::npos)
+            directory = path.substr(0, slash + 1);
+
+        std::stringstream input(source);
+        std::stringstream output;
+        std::string line;
+        while (std::getline(input, line))
+        {
+            size_t start = line.find_first_not_of(" \t");
+            if (start != std::string::npos && line.compare(start, 8, "#include") == 0)
+            {
+                size_t open = line.find('"', start);
+                size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+                std::string includePath = close == std::string::npos ? "" : directory + line.substr(open + 1, close - open - 1);
+                std::ifstream includeFile(includePath);
+                if (!includeFile.is_open())
+                {
+                    std::cout << "ERROR::SHADER::INCLUDE_NOT_SUCCESSFULLY_READ: " << line << " in " << path << std::endl;
+                    continue;
+                }
+                std::stringstream includeStream;
+                includeStream << includeFile.rdbuf();
+                output << preprocess(includeStream.str(), includePath, std::vector<std::string>()) << "\n";
+                continue;
+            }
+            output << line << "\n";
+            if (start != std::string::npos && line.compare(start, 8, "#version") == 0)
+            {
+                for (const std::string& define : defines)
+                    output << "#define " << define << "\n";
+            }
+        }
+        return output.str();
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
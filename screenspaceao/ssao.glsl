@@ -0,0 +1,61 @@
+/*
+LearnOpenGL SSAO Implementation (de Vries, 2014)
+https://learnopengl.com/Advanced-Lighting/SSAO
+Based on Starcraft II SSAO (Filion and McNaughton, 2008)
+https://www.scribd.com/document/632296500/Starcraft-2-Effects-Techniques
+Shared by the fragment (ssao.fs) and compute (ssao.comp) passes, include after gbuffer.glsl
+*/
+
+uniform sampler2D texNoise;
+
+// hemisphere sample kernel, uploaded once (C++ mirror: KernelUniforms in uniform_buffers.h)
+layout(std140) uniform KernelUniforms {
+    vec3 samples[16];
+};
+
+// parameters, a KERNEL_SIZE permutation turns the sample count into a constant the loop unrolls over
+#ifdef KERNEL_SIZE
+const int kernelSize = KERNEL_SIZE;
+#else
+uniform int kernelSize = 16;
+#endif
+uniform float radius = 1.3f;
+uniform float bias = 0.025f;
+
+// ambient occlusion of the pixel at uv, 1 = unoccluded
+float computeAO(vec2 uv)
+{
+    vec2 screenSize = getGBufferSize();
+
+    // get input for SSAO algorithm
+    vec3 fragPos = getCenterPosition(uv);
+    vec3 normal = getCenterNormal(uv);
+    vec3 randomVec = normalize(getNoise(texNoise));
+    // create TBN change-of-basis matrix: from tangent-space to view-space
+    vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
+    vec3 bitangent = cross(normal, tangent);
+    mat3 TBN = mat3(tangent, bitangent, normal);
+    // iterate over the sample kernel and calculate occlusion factor
+    float occlusion = 0.0;
+    for(int i = 0; i < kernelSize; ++i)
+    {
+        // get sample position
+        vec3 samplePos = TBN * samples[(i * temporalSampleStride + temporalFrameSlot) % 16]; // from tangent to view-space
+        samplePos = fragPos + samplePos * radius;
+        
+        // project sample position (to sample texture) (to get position on screen/texture)
+        vec4 offset = vec4(samplePos, 1.0);
+        offset = projection * offset; // from view to clip-space
+        offset.xyz /= offset.w; // perspective divide
+        offset.xyz = offset.xyz * 0.5 + 0.5; // transform to range 0.0 - 1.0
+        
+        // get sample depth
+        float tapDistance = length((offset.xy - uv) * screenSize);
+        float sampleDepth = getTapPosition(offset.xy, tapDistance).z; // get depth value of kernel sample
+        
+        // range check & accumulate
+        float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
+        occlusion += (sampleDepth >= samplePos.z + bias ? 1.0 : 0.0) * rangeCheck;
+    }
+    return 1.0 - (occlusion / kernelSize);
+}
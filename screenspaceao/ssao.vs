@@ -10,8 +10,17 @@ layout (location = 1) in vec2 aTexCoords;
 
 out vec2 TexCoords;
 
+#ifdef DEINTERLEAVED
+// maps the quarter resolution layer's quad onto the G-buffer uv of the pixels the layer holds (xy scale, zw offset)
+uniform vec4 texCoordTransform;
+#endif
+
 void main()
 {
+#ifdef DEINTERLEAVED
+    TexCoords = aTexCoords * texCoordTransform.xy + texCoordTransform.zw;
+#else
     TexCoords = aTexCoords;
+#endif
     gl_Position = vec4(aPos, 1.0);
 }
\ No newline at end of file
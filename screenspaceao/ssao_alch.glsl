@@ -0,0 +1,120 @@
+/*
+Used LearnOpenGL SSAO implementation as a base (de Vries, 2014)
+https://learnopengl.com/Advanced-Lighting/SSAO
+SSAO Alchemy implementation done by Sahil Puri using
+Alchemy Screen Space Ambeint Obscurance Algorithm (McGuire, 2011)
+https://casual-effects.com/research/McGuire2011AlchemyAO/VV11AlchemyAO.pdf
+Shared by the fragment (ssao_alch.fs) and compute (ssao_alch.comp) passes, include after gbuffer.glsl
+*/
+
+uniform sampler2D texNoise;
+
+// Parameters, KERNEL_SIZE and K permutations make the sample count and contrast exponent compile time constants
+#ifdef KERNEL_SIZE
+const int kernelSize = KERNEL_SIZE;
+#else
+uniform int kernelSize = 16;
+#endif
+uniform float radius = 1.7f; // Constant radius in world space
+uniform float bias = 0.025f;
+uniform float sigma = 1.7f; // Strength multiplier
+#ifndef K
+uniform int k = 1; // Contrast multiplier
+#endif
+uniform float beta = 0.5f; // Shadow Bias
+uniform float turns = 1.0f; // Turns parameter for sampling distribution
+const float epsilon = 0.001f; // Avoids divide by zero
+
+const float PI = 3.14159265359;
+
+// Generates a point on a disk
+vec2 DiskPoint(float sampleRadius, float x, float y, float turns)
+{
+    float r = sampleRadius * sqrt(x); 
+    float theta = y * (2.0 * PI) * turns; 
+    return vec2(r * cos(theta), r * sin(theta));
+}
+
+// Generates a pseudorandom 2D vector based on a single float input
+vec2 RandomHashValue(float randomValue)
+{
+    return fract(sin(vec2(randomValue, randomValue + 0.1)) * vec2(12.9898, 78.233)); //Commonly used pseudo-random number generator used for shaders
+}
+
+// ambient occlusion of the pixel at uv, 1 = unoccluded
+float computeAO(vec2 uv)
+{   
+
+    vec2 screenSize = getGBufferSize();
+
+    // Random value updating based on screen coordinates
+    float RANDOMVALUE = (uv.x * uv.y) * 64.0;
+
+    // Normals and positions in view-space
+    vec3 fragPos = getCenterPosition(uv);
+    vec3 normal = getCenterNormal(uv);
+    vec3 randomVec = normalize(getNoise(texNoise));
+
+    // Create TBN change-of-basis matrix: from tangent-space to view-space
+    vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
+    vec3 bitangent = cross(normal, tangent);
+    mat3 TBN = mat3(tangent, bitangent, normal);
+
+    float ao = 0.0;
+    float screen_radius = radius * 0.75 / fragPos.z; // Ball around the point
+
+#ifdef KERNEL_SIZE
+    // tap i hashes the angle a + i * stride, stepped with sin(x + s) = sin(x)cos(s) + cos(x)sin(s):
+    // one sin/cos pair per pixel and one for the stride instead of a sin per tap
+    vec2 hashAngle = vec2(RANDOMVALUE + float(temporalFrameSlot)) + vec2(0.0, 0.1);
+    vec2 hashSin = sin(hashAngle);
+    vec2 hashCos = cos(hashAngle);
+    float strideSin = sin(float(temporalSampleStride));
+    float strideCos = cos(float(temporalSampleStride));
+#endif
+    for (int i = 0; i < kernelSize; ++i)
+    {
+#ifdef KERNEL_SIZE
+        vec2 RandomValue = fract(hashSin * vec2(12.9898, 78.233));
+        vec2 nextSin = hashSin * strideCos + hashCos * strideSin;
+        hashCos = hashCos * strideCos - hashSin * strideSin;
+        hashSin = nextSin;
+#else
+        vec2 RandomValue = RandomHashValue(RANDOMVALUE + float(i * temporalSampleStride + temporalFrameSlot));
+#endif
+        vec2 disk = DiskPoint(1.0, RandomValue.x, RandomValue.y, turns);
+        vec2 samplepos = uv + (disk.xy) * screen_radius;
+
+        // Check samplepos is within the texture coordinates range
+        if (samplepos.x < 0.0 || samplepos.x > 1.0 || samplepos.y < 0.0 || samplepos.y > 1.0)
+            continue;
+        
+        // Sample position
+        vec3 samplePos = getTapPosition(samplepos, length(disk.xy * screen_radius * screenSize)); 
+        vec3 V = samplePos - fragPos;
+        float distance = length(V);
+        float rangeCheck = smoothstep(0.0, radius, distance);
+        
+        // Alchemy AO calculation
+        float occlusionFactor = max(0.0, dot(V, normal + fragPos.z * beta)) / (dot(V, V) + epsilon);
+        occlusionFactor *= rangeCheck;
+        
+        ao += occlusionFactor;
+    }
+
+    // Normalize AO
+    ao = max(0.0, 1.0 - (2.0 * sigma / float(kernelSize)) * ao);
+#ifdef K
+    // integer power, unrolled into K multiplies
+    float aoPower = 1.0;
+    for (int i = 0; i < K; ++i)
+        aoPower *= ao;
+    ao = aoPower;
+#else
+    ao = pow(ao, float(k));
+#endif
+
+
+    // Output AO value
+    return ao;
+}
@@ -1,27 +1,38 @@
 #version 330 core
 
 /*
-LearnOpenGL SSAO Blur Fragment Shader (de Vries, 2014)
+Based on LearnOpenGL SSAO Blur Fragment Shader (de Vries, 2014)
 https://learnopengl.com/code_viewer_gh.php?code=src/5.advanced_lighting/9.ssao/9.ssao_blur.fs
+Replaced the 4x4 box filter with a separable depth-aware bilateral filter, see ao_blur.glsl
+Run once with direction (1, 0) and once with (0, 1)
 */
 
 out float FragColor;
 
 in vec2 TexCoords;
 
+#include "gbuffer.glsl"
+#include "ao_blur.glsl"
+
 uniform sampler2D ssaoInput;
+uniform vec2 direction = vec2(1.0, 0.0); // blur axis, in AO texels
 
 void main() 
 {
     vec2 texelSize = 1.0 / vec2(textureSize(ssaoInput, 0));
+    float centerDepth = -getViewPosition(TexCoords).z;
+    vec3 centerNormal = useNormals ? getViewNormal(TexCoords) : vec3(0.0);
+
     float result = 0.0;
-    for (int x = -2; x < 2; ++x) 
+    float totalWeight = 0.0;
+    for (int i = -blurRadius; i <= blurRadius; ++i)
     {
-        for (int y = -2; y < 2; ++y) 
-        {
-            vec2 offset = vec2(float(x), float(y)) * texelSize;
-            result += texture(ssaoInput, TexCoords + offset).r;
-        }
+        vec2 uv = clamp(TexCoords + direction * float(i) * texelSize, 0.5 * texelSize, 1.0 - 0.5 * texelSize);
+        vec3 tapNormal = useNormals ? getViewNormal(uv) : vec3(0.0);
+        float weight = blurWeight(i, centerDepth, -getViewPosition(uv).z, centerNormal, tapNormal);
+
+        result += texture(ssaoInput, uv).r * weight;
+        totalWeight += weight;
     }
-    FragColor = result / (4.0 * 4.0);
-}  
\ No newline at end of file
+    FragColor = result / max(totalWeight, 0.0001);
+}
@@ -5,9 +5,24 @@ LearnOpenGL SSAO Geometry VS (de Vries, 2014)
 https://learnopengl.com/code_viewer_gh.php?code=src/5.advanced_lighting/9.ssao/9.ssao_geometry.fs
 */
 
+#include "normal_encoding.glsl"
+
+// with OCTAHEDRAL_NORMALS the normal target only has two channels
+#ifdef OCTAHEDRAL_NORMALS
+#define NORMAL_TYPE vec2
+#else
+#define NORMAL_TYPE vec3
+#endif
+
+// with RECONSTRUCT_POSITION the position comes from the depth buffer, so there is no gPosition target
+#ifdef RECONSTRUCT_POSITION
+layout (location = 0) out NORMAL_TYPE gNormal;
+layout (location = 1) out vec4 gAlbedo;
+#else
 layout (location = 0) out vec3 gPosition;
-layout (location = 1) out vec3 gNormal;
+layout (location = 1) out NORMAL_TYPE gNormal;
 layout (location = 2) out vec4 gAlbedo;
+#endif
 
 in vec2 TexCoords;
 in vec3 FragPos;
@@ -19,8 +34,14 @@ uniform bool useTexture;
 
 void main()
 {    
+#ifndef RECONSTRUCT_POSITION
     gPosition = FragPos;
+#endif
+#ifdef OCTAHEDRAL_NORMALS
+    gNormal = encodeNormal(normalize(Normal));
+#else
     gNormal = normalize(Normal);
+#endif
 
     if (useTexture) {
         gAlbedo = texture(textureDiffuse1, TexCoords);
@@ -6,7 +6,7 @@ https://learnopengl.com/code_viewer_gh.php?code=src/5.advanced_lighting/9.ssao/9
 */
 
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec3 aNormal; // snorm 10:10:10:2, normalized in the fragment shader
 layout (location = 2) in vec2 aTexCoords;
 
 out vec3 FragPos;
@@ -16,8 +16,11 @@ out vec3 Normal;
 uniform bool invertedNormals;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+#include "frame_uniforms.glsl"
+
+// must match depth_prepass.vs bit for bit, the geometry pass tests against its depth with GL_EQUAL
+invariant gl_Position;
 
 void main()
 {
@@ -10,8 +10,8 @@ out vec4 FragColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D gPosition;
-uniform sampler2D gNormal;
+#include "gbuffer.glsl"
+
 uniform sampler2D gAlbedo;
 uniform sampler2D ssao;
 
@@ -19,8 +19,6 @@ struct DirectionalLight {
     vec3 Direction;
     vec3 Color;
 };
-uniform DirectionalLight dirLight;
-
 
 struct Light {
     vec3 Position; // Must be in world space
@@ -29,20 +27,33 @@ struct Light {
     float Quadratic;
 };
 const int NR_LIGHTS = 14;
-uniform Light lights[NR_LIGHTS];
 
-uniform vec3 viewPos; // Camera's world-space position
-uniform mat4 invView;
+// scene lights, uploaded only when they change (C++ mirror: LightUniforms in uniform_buffers.h)
+layout(std140) uniform LightUniforms {
+    DirectionalLight dirLight;
+    Light lights[NR_LIGHTS];
+};
+
+uniform int debugView = 0; // 0 = lit, 1 = decoded normals (to compare encodings), 2 = AO only
 
 void main() {             
     // retrieve data from gbuffer
-    vec3 FragPosView = texture(gPosition, TexCoords).rgb; 
+    vec3 FragPosView = getViewPosition(TexCoords); 
     vec3 FragPos = (invView * vec4(FragPosView, 1.0)).xyz; 
-    vec3 Normal = normalize(texture(gNormal, TexCoords).rgb); 
+    vec3 Normal = getViewNormal(TexCoords); 
     vec3 Diffuse = texture(gAlbedo, TexCoords).rgb;
     float AmbientOcclusion = texture(ssao, TexCoords).r;
     float brightnessFactor = 1.2;
 
+    if (debugView == 1) {
+        FragColor = vec4(Normal * 0.5 + 0.5, 1.0);
+        return;
+    }
+    if (debugView == 2) {
+        FragColor = vec4(vec3(AmbientOcclusion), 1.0);
+        return;
+    }
+
     // calculate ambient lighting
     vec3 ambient = vec3(0.5 * Diffuse * AmbientOcclusion); 
     vec3 totalLighting = ambient;
@@ -0,0 +1,392 @@
+#ifndef TEXTURE_COOKER_H
+#define TEXTURE_COOKER_H
+
+/*
+Offline texture cooking
+cookTexture block-compresses a decoded image and its CPU box-filtered mip chain: BC1 for opaque
+diffuse maps, BC3 for diffuse maps with alpha, BC4 for single-channel data (specular, bump and height
+maps and any grayscale image, sampled as gray through the texture swizzle) and BC5 for the X and Y of
+colour tangent-space normal maps. Cooked textures are KTX 1 files next to their source
+(<image>.ktx) carrying the source's size and modification time, an edited image is cooked again
+*/
+
+#include <glad/glad.h>
+
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/gl_extensions.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/file_stamp.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct CookedLevel {
+    int width, height;
+    size_t offset; // into CookedTexture::data
+    size_t size;
+};
+
+struct CookedTexture {
+    GLenum internalFormat = 0; // one of the GL_COMPRESSED_* formats cookTexture produces, 0 when empty
+    std::vector<CookedLevel> levels;
+    std::vector<unsigned char> data;
+};
+
+inline std::string cookedTexturePath(const std::string& sourcePath)
+{
+    return sourcePath + ".ktx";
+}
+
+// whether the context can sample a cooked format, BC1 and BC3 need S3TC
+inline bool cookedFormatSupported(GLenum internalFormat, const GLExtensions& extensions)
+{
+    if (internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+        return extensions.textureCompressionS3TC;
+    return internalFormat == GL_COMPRESSED_RED_RGTC1 || internalFormat == GL_COMPRESSED_RG_RGTC2;
+}
+
+namespace texture_cooking {
+
+inline int blockBytes(GLenum internalFormat)
+{
+    return internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_RED_RGTC1 ? 8 : 16;
+}
+
+inline GLenum baseFormat(GLenum internalFormat)
+{
+    switch (internalFormat)
+    {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT: return GL_RGB;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT: return GL_RGBA;
+    case GL_COMPRESSED_RED_RGTC1: return GL_RED;
+    case GL_COMPRESSED_RG_RGTC2: return GL_RG;
+    default: return 0;
+    }
+}
+
+inline std::uint16_t to565(const int color[3])
+{
+    return (std::uint16_t)(((color[0] * 31 + 127) / 255) << 11 | ((color[1] * 63 + 127) / 255) << 5 | ((color[2] * 31 + 127) / 255));
+}
+
+inline void from565(std::uint16_t packed, int color[3])
+{
+    int r = packed >> 11, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// BC1 colour block of 16 RGBA texels, endpoints on the bounding box diagonal the colours lie along
+// (van Waveren, Real-Time DXT Compression), always in four colour mode so it also serves BC3
+inline void encodeColorBlock(const unsigned char* texels, unsigned char* out)
+{
+    int low[3] = { 255, 255, 255 }, high[3] = { 0, 0, 0 };
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 3; c++)
+        {
+            low[c] = std::min(low[c], (int)texels[i * 4 + c]);
+            high[c] = std::max(high[c], (int)texels[i * 4 + c]);
+        }
+    // inset by 1/16 of the range so the interpolated colours cover the interior
+    for (int c = 0; c < 3; c++)
+    {
+        int inset = (high[c] - low[c]) >> 4;
+        low[c] += inset;
+        high[c] -= inset;
+    }
+    // pick the diagonal: green and blue swap ends when they fall as red rises
+    int centre[3] = { (low[0] + high[0]) / 2, (low[1] + high[1]) / 2, (low[2] + high[2]) / 2 };
+    int covarianceG = 0, covarianceB = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int r = texels[i * 4] - centre[0];
+        covarianceG += r * (texels[i * 4 + 1] - centre[1]);
+        covarianceB += r * (texels[i * 4 + 2] - centre[2]);
+    }
+    if (covarianceG < 0)
+        std::swap(low[1], high[1]);
+    if (covarianceB < 0)
+        std::swap(low[2], high[2]);
+
+    std::uint16_t color0 = to565(high), color1 = to565(low);
+    if (color0 < color1)
+        std::swap(color0, color1);
+    std::uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        from565(color0, palette[0]);
+        from565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDistance = 1 << 30;
+            for (int p = 0; p < 4; p++)
+            {
+                int distance = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int d = texels[i * 4 + c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= (std::uint32_t)best << (2 * i);
+        }
+    }
+    out[0] = color0 & 0xFF;
+    out[1] = color0 >> 8;
+    out[2] = color1 & 0xFF;
+    out[3] = color1 >> 8;
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+// BC4 block of one channel of 16 RGBA texels (also the alpha block of BC3 and each half of BC5),
+// eight value mode between the block's extremes
+inline void encodeChannelBlock(const unsigned char* texels, int channel, unsigned char* out)
+{
+    int low = 255, high = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        low = std::min(low, (int)texels[i * 4 + channel]);
+        high = std::max(high, (int)texels[i * 4 + channel]);
+    }
+    std::uint64_t indices = 0;
+    if (high > low)
+        for (int i = 0; i < 16; i++)
+        {
+            // nearest of the 8 steps from low to high, index 0 is high, 1 is low and 2..7 run from high to low
+            int step = ((texels[i * 4 + channel] - low) * 14 + (high - low)) / (2 * (high - low));
+            int index = step == 7 ? 0 : (step == 0 ? 1 : 8 - step);
+            indices |= (std::uint64_t)index << (3 * i);
+        }
+    out[0] = (unsigned char)high;
+    out[1] = (unsigned char)low;
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+// 2x2 box filter of an RGBA8 image, odd edges repeat their last texel
+inline std::vector<unsigned char> downsample(const std::vector<unsigned char>& image, int width, int height)
+{
+    int halfWidth = std::max(1, width / 2), halfHeight = std::max(1, height / 2);
+    std::vector<unsigned char> half((size_t)halfWidth * halfHeight * 4);
+    for (int y = 0; y < halfHeight; y++)
+        for (int x = 0; x < halfWidth; x++)
+        {
+            int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+            for (int c = 0; c < 4; c++)
+            {
+                int sum = image[((size_t)y0 * width + x0) * 4 + c] + image[((size_t)y0 * width + x1) * 4 + c]
+                    + image[((size_t)y1 * width + x0) * 4 + c] + image[((size_t)y1 * width + x1) * 4 + c];
+                half[((size_t)y * halfWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    return half;
+}
+
+inline void compressLevel(const std::vector<unsigned char>& image, int width, int height, GLenum internalFormat, unsigned char* out)
+{
+    unsigned char texels[16 * 4];
+    for (int by = 0; by < height; by += 4)
+        for (int bx = 0; bx < width; bx += 4)
+        {
+            // blocks past the edge of small mips repeat the edge texels
+            for (int i = 0; i < 16; i++)
+            {
+                int x = std::min(bx + (i & 3), width - 1), y = std::min(by + (i >> 2), height - 1);
+                std::memcpy(texels + i * 4, &image[((size_t)y * width + x) * 4], 4);
+            }
+            switch (internalFormat)
+            {
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+                encodeColorBlock(texels, out);
+                out += 8;
+                break;
+            case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+                encodeChannelBlock(texels, 3, out);
+                encodeColorBlock(texels, out + 8);
+                out += 16;
+                break;
+            case GL_COMPRESSED_RED_RGTC1:
+                encodeChannelBlock(texels, 0, out);
+                out += 8;
+                break;
+            default:
+                encodeChannelBlock(texels, 0, out);
+                encodeChannelBlock(texels, 1, out + 8);
+                out += 16;
+                break;
+            }
+        }
+}
+
+const unsigned char KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+const std::uint32_t KTX_ENDIANNESS = 0x04030201;
+const char KTX_SOURCE_KEY[] = "ssao.source"; // "<size> <modification time>" of the cooked image
+
+struct KTXHeader {
+    std::uint32_t endianness;
+    std::uint32_t glType;          // 0 for compressed data
+    std::uint32_t glTypeSize;
+    std::uint32_t glFormat;        // 0 for compressed data
+    std::uint32_t glInternalFormat;
+    std::uint32_t glBaseInternalFormat;
+    std::uint32_t pixelWidth;
+    std::uint32_t pixelHeight;
+    std::uint32_t pixelDepth;
+    std::uint32_t numberOfArrayElements;
+    std::uint32_t numberOfFaces;
+    std::uint32_t numberOfMipmapLevels;
+    std::uint32_t bytesOfKeyValueData;
+};
+
+inline std::string sourceValue(std::uint64_t sourceSize, std::int64_t sourceTime)
+{
+    return std::to_string(sourceSize) + " " + std::to_string(sourceTime);
+}
+
+} // namespace texture_cooking
+
+// format an image cooks to from its sampler type (texture_diffuse, texture_specular, ...) and content
+inline GLenum cookedFormat(const std::string& type, const unsigned char* rgba, int width, int height, int components)
+{
+    bool grayscale = true, alpha = false;
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        const unsigned char* texel = rgba + i * 4;
+        grayscale = grayscale && texel[0] == texel[1] && texel[1] == texel[2];
+        alpha = alpha || texel[3] != 255;
+    }
+    if (type == "texture_diffuse")
+        return components == 4 && alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    if (grayscale || components < 3 || type != "texture_normal")
+        return GL_COMPRESSED_RED_RGTC1;
+    return GL_COMPRESSED_RG_RGTC2; // a sampler would rebuild z as sqrt(1 - x*x - y*y)
+}
+
+// compresses an RGBA8 image (stbi_load with 4 channels) and its mip chain down to 1x1
+inline CookedTexture cookTexture(const unsigned char* rgba, int width, int height, GLenum internalFormat)
+{
+    using namespace texture_cooking;
+    CookedTexture cooked;
+    cooked.internalFormat = internalFormat;
+    std::vector<unsigned char> level(rgba, rgba + (size_t)width * height * 4);
+    for (;;)
+    {
+        CookedLevel entry = { width, height, cooked.data.size(), (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(internalFormat) };
+        cooked.data.resize(entry.offset + entry.size);
+        compressLevel(level, width, height, internalFormat, &cooked.data[entry.offset]);
+        cooked.levels.push_back(entry);
+        if (width == 1 && height == 1)
+            break;
+        level = downsample(level, width, height);
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return cooked;
+}
+
+// writes a cooked texture as KTX 1 with the stamp of the image it was cooked from
+inline bool writeCookedTexture(const std::string& path, const CookedTexture& cooked, std::uint64_t sourceSize, std::int64_t sourceTime)
+{
+    using namespace texture_cooking;
+    std::string keyValue = std::string(KTX_SOURCE_KEY) + '\0' + sourceValue(sourceSize, sourceTime) + '\0';
+    std::uint32_t keyValueSize = (std::uint32_t)keyValue.size();
+    keyValue.resize((keyValue.size() + 3) & ~(size_t)3, '\0');
+
+    KTXHeader header = {};
+    header.endianness = KTX_ENDIANNESS;
+    header.glTypeSize = 1;
+    header.glInternalFormat = cooked.internalFormat;
+    header.glBaseInternalFormat = baseFormat(cooked.internalFormat);
+    header.pixelWidth = cooked.levels[0].width;
+    header.pixelHeight = cooked.levels[0].height;
+    header.numberOfFaces = 1;
+    header.numberOfMipmapLevels = (std::uint32_t)cooked.levels.size();
+    header.bytesOfKeyValueData = (std::uint32_t)(sizeof(std::uint32_t) + keyValue.size());
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        return false;
+    file.write((const char*)KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)&keyValueSize, sizeof(keyValueSize));
+    file.write(keyValue.data(), keyValue.size());
+    for (const CookedLevel& level : cooked.levels)
+    {
+        // block sizes are multiples of 4, no mip padding needed
+        std::uint32_t imageSize = (std::uint32_t)level.size;
+        file.write((const char*)&imageSize, sizeof(imageSize));
+        file.write((const char*)&cooked.data[level.offset], level.size);
+    }
+    return file.good();
+}
+
+// reads a cooked texture, false when it is missing, damaged or was cooked from another version of the source
+inline bool readCookedTexture(const std::string& path, std::uint64_t sourceSize, std::int64_t sourceTime, CookedTexture& cooked)
+{
+    using namespace texture_cooking;
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+        return false;
+    std::vector<char> bytes((size_t)file.tellg());
+    file.seekg(0);
+    if (!file.read(bytes.data(), bytes.size()))
+        return false;
+
+    KTXHeader header;
+    size_t position = sizeof(KTX_IDENTIFIER) + sizeof(KTXHeader);
+    if (bytes.size() < position || std::memcmp(bytes.data(), KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0)
+        return false;
+    std::memcpy(&header, &bytes[sizeof(KTX_IDENTIFIER)], sizeof(header));
+    if (header.endianness != KTX_ENDIANNESS || header.glType != 0 || baseFormat(header.glInternalFormat) == 0
+        || header.numberOfFaces != 1 || header.pixelDepth != 0 || header.numberOfArrayElements != 0
+        || header.numberOfMipmapLevels == 0 || header.numberOfMipmapLevels > 32
+        || header.bytesOfKeyValueData > bytes.size() - position)
+        return false;
+
+    // the source stamp must match
+    std::string keyValue(&bytes[position], header.bytesOfKeyValueData);
+    std::string expected = std::string(KTX_SOURCE_KEY) + '\0' + sourceValue(sourceSize, sourceTime) + '\0';
+    if (keyValue.size() < sizeof(std::uint32_t) + expected.size() || keyValue.compare(sizeof(std::uint32_t), expected.size(), expected) != 0)
+        return false;
+    position += header.bytesOfKeyValueData;
+
+    cooked.internalFormat = header.glInternalFormat;
+    cooked.levels.clear();
+    cooked.data.clear();
+    int width = (int)header.pixelWidth, height = (int)header.pixelHeight;
+    for (std::uint32_t i = 0; i < header.numberOfMipmapLevels; i++)
+    {
+        std::uint32_t imageSize;
+        if (bytes.size() - position < sizeof(imageSize))
+            return false;
+        std::memcpy(&imageSize, &bytes[position], sizeof(imageSize));
+        position += sizeof(imageSize);
+        size_t expectedSize = (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(header.glInternalFormat);
+        if (imageSize != expectedSize || bytes.size() - position < imageSize)
+            return false;
+        CookedLevel level = { width, height, cooked.data.size(), imageSize };
+        cooked.data.insert(cooked.data.end(), &bytes[position], &bytes[position] + imageSize);
+        cooked.levels.push_back(level);
+        position += (imageSize + 3) & ~(size_t)3;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return true;
+}
+#endif
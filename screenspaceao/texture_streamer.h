@@ -0,0 +1,446 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+/*
+Asynchronous texture loading
+request() returns a texture holding a white 1x1 placeholder straight away and queues the image file
+for a pool of worker threads running stbi_load. update(), called on the GL thread once per frame,
+copies decoded images into one segment of a ring of pixel unpack buffers (persistently mapped with
+GL 4.4 buffer storage, mapped per frame otherwise) and uploads them into their textures from there,
+so decoding runs in parallel and the GL thread only copies and issues uploads
+Images with an up to date cooked file (see texture_cooker.h) load that instead, block-compressed with
+their whole mip chain, and with cooking enabled the workers cook every image that has none
+*/
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/gl_extensions.h>
+#include <C:/Users/Admin/Dissertation/screenspaceao/screenspaceao/texture_cooker.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class TextureStreamer
+{
+public:
+    ~TextureStreamer()
+    {
+        stopWorkers();
+    }
+
+    // picks the upload path and how cooked textures are used, call once a context exists and before the first request
+    void enable(const GLExtensions& extensions, bool useCookedTextures, bool cookTextures)
+    {
+        persistent = extensions.persistentMapping;
+        bufferStorage = extensions.bufferStorage;
+        this->extensions = extensions;
+        useCooked = useCookedTextures;
+        cook = useCookedTextures && cookTextures;
+    }
+
+    // texture for the image file at path, a white placeholder until update() uploads the decoded image
+    // type is the sampler it is bound as (texture_diffuse, ...), which picks its cooked format
+    unsigned int request(const std::string& path, const std::string& type)
+    {
+        static const unsigned char white[4] = { 255, 255, 255, 255 };
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // no mips until the real image arrives
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        startWorkers();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back({ texture, path, type });
+            requested++;
+        }
+        jobReady.notify_one();
+        return texture;
+    }
+
+    // uploads as many decoded images as fit this frame's upload segment, returns how many textures completed
+    int update()
+    {
+        return upload(false);
+    }
+
+    // blocks until every requested texture is decoded and uploaded
+    void finish()
+    {
+        while (pending() > 0)
+            upload(true);
+    }
+
+    // textures requested but not uploaded yet
+    int pending()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return requested - completed;
+    }
+
+    int requestedCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return requested;
+    }
+
+    // log line once every texture arrived, how many came cooked and the memory their images take
+    std::string summary()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(1)
+            << "Textures: " << completed << " loaded, " << cookedTextures << " block-compressed (" << cookedNow << " cooked this run), "
+            << textureBytes / (1024.0 * 1024.0) << " MB of texture data";
+        if (!useCooked)
+            line << " (cooked textures disabled)";
+        return line.str();
+    }
+
+    // deletes the upload buffers, call while the context is still current
+    void release()
+    {
+        for (Segment& segment : segments)
+        {
+            if (segment.fence)
+                glDeleteSync(segment.fence);
+            if (segment.mapped)
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, segment.buffer);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            }
+            glDeleteBuffers(1, &segment.buffer);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        segments.clear();
+    }
+
+private:
+    static const size_t SEGMENT_SIZE = 16 << 20; // upload budget of one frame, larger images upload straight from client memory
+    static const int SEGMENT_COUNT = 3;          // frames an upload segment may still be read by the GPU
+
+    struct DecodeJob {
+        unsigned int texture;
+        std::string path;
+        std::string type;
+    };
+    struct DecodedImage {
+        unsigned int texture = 0;
+        std::string path;
+        unsigned char* pixels = nullptr; // stbi_load result, nullptr when decoding failed or the texture is cooked
+        int width = 0, height = 0, components = 0;
+        CookedTexture cooked;            // block-compressed mips, empty when loaded from the source image
+        bool loaded() const { return pixels || !cooked.data.empty(); }
+        const unsigned char* bytes() const { return pixels ? pixels : cooked.data.data(); }
+        size_t size() const { return pixels ? (size_t)width * height * components : cooked.data.size(); }
+    };
+    struct Segment {
+        unsigned int buffer = 0;
+        unsigned char* mapped = nullptr; // persistent mapping, nullptr without buffer storage
+        GLsync fence = 0;                // signalled once the GPU read the segment's last uploads
+    };
+
+    bool persistent = false;
+    PFNBUFFERSTORAGEPROC bufferStorage = nullptr;
+    GLExtensions extensions;
+    bool useCooked = true;
+    bool cook = false;
+    std::vector<Segment> segments;
+    int currentSegment = 0;
+
+    // shared with the workers
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable decodedReady;
+    std::deque<DecodeJob> jobs;
+    std::deque<DecodedImage> decoded;
+    bool stopping = false;
+    int requested = 0;
+    int completed = 0;
+    int cookedTextures = 0;
+    int cookedNow = 0;
+    size_t textureBytes = 0; // uploaded image data including mips, raw images count a third extra for theirs
+    std::vector<std::thread> workers;
+
+    // GL thread only, decoded images that didn't fit the last segment
+    std::deque<DecodedImage> ready;
+
+    void startWorkers()
+    {
+        if (!workers.empty())
+            return;
+        unsigned int count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        for (unsigned int i = 0; i < count; i++)
+            workers.emplace_back(&TextureStreamer::decodeLoop, this);
+    }
+
+    void stopWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+        workers.clear();
+        for (DecodedImage& image : decoded)
+            stbi_image_free(image.pixels);
+        for (DecodedImage& image : ready)
+            stbi_image_free(image.pixels);
+        decoded.clear();
+        ready.clear();
+    }
+
+    void decodeLoop()
+    {
+        for (;;)
+        {
+            DecodeJob job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (stopping)
+                    return;
+                job = jobs.front();
+                jobs.pop_front();
+            }
+            DecodedImage image;
+            image.texture = job.texture;
+            image.path = job.path;
+            bool cookedThisRun = load(job, image);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                cookedNow += cookedThisRun ? 1 : 0;
+                decoded.push_back(std::move(image));
+            }
+            decodedReady.notify_one();
+        }
+    }
+
+    // the cooked texture of the job's image if there is a current one, else the image itself (cooking it
+    // when enabled), returns whether it was cooked here
+    bool load(const DecodeJob& job, DecodedImage& image)
+    {
+        std::uint64_t sourceSize = 0;
+        std::int64_t sourceTime = 0;
+        bool stamped = useCooked && fileStamp(job.path, sourceSize, sourceTime);
+        std::string cookedPath = cookedTexturePath(job.path);
+        if (stamped && readCookedTexture(cookedPath, sourceSize, sourceTime, image.cooked))
+        {
+            if (cookedFormatSupported(image.cooked.internalFormat, extensions))
+                return false;
+            image.cooked = CookedTexture();
+        }
+        if (!stamped || !cook)
+        {
+            image.pixels = stbi_load(job.path.c_str(), &image.width, &image.height, &image.components, 0);
+            return false;
+        }
+
+        unsigned char* rgba = stbi_load(job.path.c_str(), &image.width, &image.height, &image.components, 4);
+        if (!rgba)
+            return false;
+        GLenum format = cookedFormat(job.type, rgba, image.width, image.height, image.components);
+        if (!cookedFormatSupported(format, extensions))
+        {
+            // keep the decoded image, as four channels
+            image.pixels = rgba;
+            image.components = 4;
+            return false;
+        }
+        image.cooked = cookTexture(rgba, image.width, image.height, format);
+        stbi_image_free(rgba);
+        if (!writeCookedTexture(cookedPath, image.cooked, sourceSize, sourceTime))
+            std::cout << "Unable to write cooked texture: " << cookedPath << std::endl;
+        return true;
+    }
+
+    void createSegments()
+    {
+        segments.resize(SEGMENT_COUNT);
+        for (Segment& segment : segments)
+        {
+            glGenBuffers(1, &segment.buffer);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, segment.buffer);
+            if (persistent)
+            {
+                GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                bufferStorage(GL_PIXEL_UNPACK_BUFFER, SEGMENT_SIZE, NULL, flags);
+                segment.mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, SEGMENT_SIZE, flags);
+            }
+            else
+                glBufferData(GL_PIXEL_UNPACK_BUFFER, SEGMENT_SIZE, NULL, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    static GLenum pixelFormat(int components)
+    {
+        switch (components)
+        {
+        case 1: return GL_RED;
+        case 2: return GL_RG;
+        case 3: return GL_RGB;
+        default: return GL_RGBA;
+        }
+    }
+
+    // defines the texture's mips from the image's bytes, at source in client memory or at offset in the bound unpack buffer,
+    // returns the bytes the texture takes
+    static size_t uploadImage(const DecodedImage& image, const unsigned char* source, size_t offset)
+    {
+        glBindTexture(GL_TEXTURE_2D, image.texture);
+        if (image.pixels)
+        {
+            GLenum format = pixelFormat(image.components);
+            glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, source ? (const void*)source : (const void*)offset);
+            glGenerateMipmap(GL_TEXTURE_2D);
+        }
+        else
+        {
+            const CookedTexture& cooked = image.cooked;
+            for (size_t level = 0; level < cooked.levels.size(); level++)
+            {
+                const CookedLevel& mip = cooked.levels[level];
+                const void* data = source ? (const void*)(source + mip.offset) : (const void*)(offset + mip.offset);
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, cooked.internalFormat, mip.width, mip.height, 0, (GLsizei)mip.size, data);
+            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)cooked.levels.size() - 1);
+            if (cooked.internalFormat == GL_COMPRESSED_RED_RGTC1)
+            {
+                // gray like the single-channel image it came from would be as RGB
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+            }
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        return image.pixels ? image.size() * 4 / 3 : image.cooked.data.size();
+    }
+
+    int upload(bool wait)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (wait && ready.empty())
+                decodedReady.wait(lock, [this] { return !decoded.empty(); });
+            while (!decoded.empty())
+            {
+                ready.push_back(std::move(decoded.front()));
+                decoded.pop_front();
+            }
+        }
+        if (ready.empty())
+            return 0;
+        if (segments.empty())
+            createSegments();
+
+        // the segment was last filled SEGMENT_COUNT updates ago, its uploads have normally long finished
+        Segment& segment = segments[currentSegment];
+        currentSegment = (currentSegment + 1) % SEGMENT_COUNT;
+        if (segment.fence)
+        {
+            while (glClientWaitSync(segment.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+                ;
+            glDeleteSync(segment.fence);
+            segment.fence = 0;
+        }
+
+        // take images in order while they fit, failed and oversized ones bypass the segment
+        std::vector<DecodedImage> batch;
+        std::vector<size_t> offsets;
+        std::vector<DecodedImage> direct;
+        size_t used = 0;
+        while (!ready.empty())
+        {
+            DecodedImage& image = ready.front();
+            if (!image.loaded() || image.size() > SEGMENT_SIZE)
+                direct.push_back(std::move(image));
+            else if (used + image.size() <= SEGMENT_SIZE)
+            {
+                offsets.push_back(used);
+                used = (used + image.size() + 15) & ~(size_t)15;
+                batch.push_back(std::move(image));
+            }
+            else
+                break;
+            ready.pop_front();
+        }
+
+        size_t bytes = 0;
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // stbi rows are tightly packed
+        if (!batch.empty())
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, segment.buffer);
+            unsigned char* mapped = segment.mapped;
+            if (!mapped)
+                mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, SEGMENT_SIZE, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (mapped)
+            {
+                for (size_t i = 0; i < batch.size(); i++)
+                    std::memcpy(mapped + offsets[i], batch[i].bytes(), batch[i].size());
+                if (!segment.mapped)
+                    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                for (size_t i = 0; i < batch.size(); i++)
+                    bytes += uploadImage(batch[i], nullptr, offsets[i]);
+                if (persistent)
+                    segment.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            if (!mapped)
+            {
+                direct.insert(direct.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+                batch.clear();
+            }
+            else
+                for (DecodedImage& image : batch)
+                    stbi_image_free(image.pixels);
+        }
+        for (DecodedImage& image : direct)
+        {
+            if (image.loaded())
+                bytes += uploadImage(image, image.bytes(), 0);
+            else
+                std::cout << "Texture failed to load at path: " << image.path << std::endl;
+            stbi_image_free(image.pixels);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        int finished = (int)(batch.size() + direct.size());
+        int cooked = 0;
+        for (const DecodedImage& image : batch)
+            cooked += image.cooked.data.empty() ? 0 : 1;
+        for (const DecodedImage& image : direct)
+            cooked += image.cooked.data.empty() ? 0 : 1;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            completed += finished;
+            cookedTextures += cooked;
+            textureBytes += bytes;
+        }
+        return finished;
+    }
+};
+
+// the streamer every model loads its textures through
+inline TextureStreamer& textureStreamer()
+{
+    static TextureStreamer streamer;
+    return streamer;
+}
+#endif
@@ -0,0 +1,113 @@
+#ifndef UNIFORM_BUFFERS_H
+#define UNIFORM_BUFFERS_H
+
+/*
+std140 uniform buffers shared by every program
+C++ mirrors of the uniform blocks in frame_uniforms.glsl, ssao_lighting.fs and ssao.glsl,
+each bound once to a fixed binding point and only re-uploaded when its contents change
+*/
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstring>
+
+// binding point of each block, every program's blocks are pointed at these by bindUniformBlocks
+enum UniformBlockBinding {
+    FRAME_UNIFORMS_BINDING = 0,
+    LIGHT_UNIFORMS_BINDING = 1,
+    KERNEL_UNIFORMS_BINDING = 2
+};
+
+// FrameUniforms in frame_uniforms.glsl
+struct FrameUniforms {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 invView;
+    glm::mat4 invProjection;
+    glm::vec3 viewPos;
+    float pad0;
+};
+
+// DirectionalLight in ssao_lighting.fs, vec3s are 16 byte aligned in std140
+struct DirectionalLightStd140 {
+    glm::vec3 direction;
+    float pad0;
+    glm::vec3 color;
+    float pad1;
+};
+
+// Light in ssao_lighting.fs, Linear packs into the tail of Color's 16 bytes
+struct PointLightStd140 {
+    glm::vec3 position;
+    float pad0;
+    glm::vec3 color;
+    float linear;
+    float quadratic;
+    float pad1[3];
+};
+
+const int MAX_LIGHTS = 14; // matches NR_LIGHTS in ssao_lighting.fs
+
+// LightUniforms in ssao_lighting.fs
+struct LightUniforms {
+    DirectionalLightStd140 dirLight;
+    PointLightStd140 lights[MAX_LIGHTS];
+};
+
+// KernelUniforms in ssao.glsl, std140 gives every array element a 16 byte stride
+struct KernelUniforms {
+    glm::vec4 samples[16];
+};
+
+// points a program's uniform blocks at the shared binding points, blocks the program doesn't use are skipped
+inline void bindUniformBlocks(unsigned int program)
+{
+    static const struct { const char* name; GLuint binding; } blocks[] = {
+        { "FrameUniforms", FRAME_UNIFORMS_BINDING },
+        { "LightUniforms", LIGHT_UNIFORMS_BINDING },
+        { "KernelUniforms", KERNEL_UNIFORMS_BINDING },
+    };
+    for (const auto& block : blocks)
+    {
+        GLuint index = glGetUniformBlockIndex(program, block.name);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, index, block.binding);
+    }
+}
+
+// uniform buffer holding one T, bound to its binding point for the lifetime of the program
+template <typename T>
+class UniformBuffer
+{
+public:
+    unsigned int ID;
+
+    UniformBuffer(UniformBlockBinding binding)
+    {
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, ID);
+    }
+
+    // uploads data unless the buffer already holds exactly that, returns whether it uploaded
+    // (compared bytewise, so value-initialize T to keep the padding stable)
+    bool update(const T& data)
+    {
+        if (uploaded && std::memcmp(&data, &contents, sizeof(T)) == 0)
+            return false;
+        std::memcpy(&contents, &data, sizeof(T));
+        uploaded = true;
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &contents);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        return true;
+    }
+
+private:
+    T contents;
+    bool uploaded = false;
+};
+#endif